@@ -6,6 +6,7 @@
 #pragma once
 
 #include "Weather.hpp"
+#include "Panels.hpp"
 #include <nvs.h>
 
 
@@ -25,13 +26,17 @@ public:
 
    Weather weather;          //!< All the openweathermap data
 
+   PanelState panels;        //!< Hashes of the panels on the e-paper
+
 public:
    MyData()
-      : wifiRSSI(0)
+      : nvsCounter(0)
+      , wifiRSSI(0)
       , batteryVolt(0.0)
       , batteryCapacity(0)
       , sht30Temperatur(0)
       , sht30Humidity(0)
+      , panels()
    {
    }
 
@@ -60,6 +65,12 @@ public:
       nvs_handle nvs_arg;
       nvs_open("Setting", NVS_READONLY, &nvs_arg);
       nvs_get_u16(nvs_arg, "nvsCounter", &nvsCounter);
+
+      size_t length = 0;
+      if (nvs_get_blob(nvs_arg, "panels", NULL, &length) != ESP_OK || length != sizeof(panels) ||
+          nvs_get_blob(nvs_arg, "panels", &panels, &length) != ESP_OK) {
+         panels = PanelState();
+      }
       nvs_close(nvs_arg);
    }
    
@@ -69,6 +80,7 @@ public:
       nvs_handle nvs_arg;
       nvs_open("Setting", NVS_READWRITE, &nvs_arg);
       nvs_set_u16(nvs_arg, "nvsCounter", nvsCounter);
+      nvs_set_blob(nvs_arg, "panels", &panels, sizeof(panels));
       nvs_commit(nvs_arg);
       nvs_close(nvs_arg);
    }
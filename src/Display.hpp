@@ -5,27 +5,93 @@
   */
 #pragma once
 #include "Data.hpp"
-#include "Icons.hpp"
-
+#include "IconMap.hpp"
+#include "GlyphAtlas.hpp"
+#include "RasterTarget.hpp"
+#include "FrameDiff.hpp"
+#include "FrameStore.hpp"
+#include "Layout.hpp"
+#include "RenderPool.hpp"
+#include "Waveform.hpp"
+#include "Trig.hpp"
+
+// Draw the weather icons from the vector paths in VectorIcons.hpp instead of the bitmaps.
+// #define USE_VECTOR_ICONS 1
+
+#ifdef USE_VECTOR_ICONS
+#include "VectorIcons.hpp"
+#endif
+
+// Render the display in horizontal bands of this height instead of a full frame canvas of 259 KB.
+// The bands are not compared with the displayed frame, the changed panels are updated completely.
+// #define BAND_HEIGHT 60
+
+// Render the regions of the layout on this many threads, one for every core, in the full frame mode.
+// Every region is drawn into its own canvas, which needs memory of the size of the frame canvas.
+// #define PARALLEL_RENDER 2
+
+/* Layers of the drawing, the static layer is the same on every refresh */
+enum DrawLayer : uint8_t
+{
+   LAYER_STATIC  = 1, //!< Frames, headings, labels and the compass rose
+   LAYER_DYNAMIC = 2, //!< Everything that depends on the data
+   LAYER_ALL     = 3
+};
 
 M5EPD_Canvas canvas(&M5.EPD); // Main canvas of the e-paper
+TextAtlas    textAtlas;        // Pre-rasterized glyphs of the text sizes
+
+/* Frame buffer of a canvas for the direct drawing functions */
+inline RasterTarget CanvasTarget(M5EPD_Canvas &target)
+{
+   return RasterTarget((uint8_t *) target.frameBuffer(), target.width(), target.height());
+}
 
 /* Main class for drawing the content to the e-paper display. */
 class WeatherDisplay
 {
 protected:
    MyData &myData; //!< Reference to the global data
+   M5EPD_Canvas &canvas; //!< Canvas the Draw functions draw into, the main canvas or the canvas of a region
    int     maxX;   //!< Max width of the e-paper
    int     maxY;   //!< Max height of the e-paper
+   const DisplayLayout &layout; //!< Panels and borders of the e-paper, checked at compile time
+   uint8_t textSize; //!< Current text size of the canvas
+   uint8_t layers;   //!< DrawLayer flags of the parts the Draw functions draw
+   int     originX;  //!< E-paper position of the left canvas column, the Draw functions use e-paper coordinates
+   int     originY;  //!< E-paper position of the top canvas row, the canvas area is the clip rectangle
+   bool     prepared;      //!< Prepare() has drawn the background and the indoor panel into the canvas
+   uint32_t preparedHash;  //!< Input hash of the indoor panel drawn by Prepare()
+   uint8_t *preparedFrame; //!< Displayed frame of the last wake loaded by Prepare(), NULL if unknown
 
 protected:
+   bool StaticLayer() const  { return (layers & LAYER_STATIC) != 0; }
+   bool DynamicLayer() const { return (layers & LAYER_DYNAMIC) != 0; }
+
+   void SetTextSize(uint8_t size);
+   PanelRect ClipRect();
+   bool IsVisible(const PanelRect &rect);
+   PanelRect TextRect(const String &text, int x, int y, uint8_t datum);
+   void DrawString(const String &text, int x, int y);
+   void DrawCentreString(const String &text, int x, int y);
+   void DrawRightString(const String &text, int x, int y);
+
+   void DrawHLine(int x, int y, int length, uint8_t gray);
+   void DrawVLine(int x, int y, int length, uint8_t gray);
+   void DrawRect(int x, int y, int w, int h, uint8_t gray);
+   void FillRect(int x, int y, int w, int h, uint8_t gray);
+   void DrawLine(int x0, int y0, int x1, int y1, uint8_t gray);
+   void FillCircle(int x, int y, int r, uint8_t gray);
+   void FillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t gray);
+
    void DrawCircle(int32_t x, int32_t y, int32_t r, uint32_t color, int32_t degFrom = 0, int32_t degTo = 360);
    void Arrow(int x, int y, int asize, float aangle, int pwidth, int plength);
    void DisplayDisplayWindSection(int x, int y, float angle, float windspeed, int radius);    
    
-   void DrawIcon(int x, int y, const uint16_t *icon, int dx = 64, int dy = 64, bool highContrast = false);
+   void DrawIcon(int x, int y, const Icon &icon, bool highContrast = false);
+   void DrawIcon(int x, int y, IconId id, int size, bool highContrast = false);
    
-   void DrawHead();
+   void DrawHead(int x, int y, int dx, int dy);
    void DrawRSSI(int x, int y);
    void DrawBattery(int x, int y);
 
@@ -33,42 +99,290 @@ protected:
    void DrawSunInfo(int x, int y, int dx, int dy);
    void DrawWindInfo(int x, int y, int dx, int dy);
    void DrawM5PaperInfo(int x, int y, int dx, int dy);
+   PanelRect GetInfoField(InfoField field, int x, int y, int dx, String &text);
+   void DrawInfoField(InfoField field, int x, int y, int dx);
+   void GetInfoFields(InfoFieldState fields[INFO_COUNT]);
+   m5epd_update_mode_t PushInfoRect(const PanelRect &rect, bool clean);
 
    void DrawDaily(int x, int y, int dx, int dy, Weather &weather, int index);
    
    void DrawGraph(int x, int y, int dx, int dy, String title, int xMin, int xMax, int yMin, int yMax, float values[], float values2[]);
    void DrawDualGraph(int x, int y, int dx, int dy, String title, int xMin, int xMax, int yMin, int yMax, float values[], int offsetB, int yMinB, int yMaxB, float valuesB[]);
 
+   void DrawPanel(PanelId panel, const PanelRect &box);
+   void DrawLayout(const bool draw[PANEL_COUNT]);
+   void DrawRegions(const bool draw[PANEL_COUNT]);
+
+   uint32_t GetIndoorHash();
+   void GetPanelHashes(uint32_t hash[PANEL_COUNT]);
+   void PushRect(const PanelRect &rect, m5epd_update_mode_t mode);
+   uint32_t GetBackgroundId();
+   void LoadBackground();
+   uint8_t *LoadPreviousFrame();
+   void PushChanges(const uint8_t *previous, const bool push[PANEL_COUNT], const bool clean[PANEL_COUNT], const bool draw[PANEL_COUNT], const PanelRect rects[PANEL_COUNT]);
+   void StoreFrame(uint8_t *previous, const bool push[PANEL_COUNT], const PanelRect rects[PANEL_COUNT]);
+   void UpdatePanels(const m5epd_update_mode_t modes[PANEL_COUNT], const bool push[PANEL_COUNT], const bool clean[PANEL_COUNT], const PanelRect rects[PANEL_COUNT]);
+
 public:
-   WeatherDisplay(MyData &md, int x = 960, int y = 540)
+   WeatherDisplay(MyData &md)
       : myData(md)
-      , maxX(x)
-      , maxY(y)
+      , canvas(::canvas)
+      , maxX(layout960x540.width)
+      , maxY(layout960x540.height)
+      , layout(layout960x540)
+      , textSize(1)
+      , layers(LAYER_ALL)
+      , originX(0)
+      , originY(0)
+      , prepared(false)
+      , preparedHash(0)
+      , preparedFrame(NULL)
    {
    }
 
+   /* Helper of the same display that draws into the canvas of a region */
+   WeatherDisplay(const WeatherDisplay &display, M5EPD_Canvas &target)
+      : myData(display.myData)
+      , canvas(target)
+      , maxX(display.maxX)
+      , maxY(display.maxY)
+      , layout(display.layout)
+      , textSize(1)
+      , layers(display.layers)
+      , originX(0)
+      , originY(0)
+      , prepared(false)
+      , preparedHash(0)
+      , preparedFrame(NULL)
+   {
+   }
+
+   void DrawRegion(int index, M5EPD_Canvas &target);
+
+   void Prepare();
+
    void Show();
 
    void ShowM5PaperInfo();
 };
 
-/* Draw a circle with optional start and end point */
+/* Set the text size of the canvas and of the glyph atlas */
+void WeatherDisplay::SetTextSize(uint8_t size)
+{
+   textSize = size;
+   canvas.setTextSize(size);
+}
+
+/* E-paper area of the canvas, all drawing is clipped to it */
+PanelRect WeatherDisplay::ClipRect()
+{
+   return PanelRect { originX, originY, canvas.width(), canvas.height() };
+}
+
+/* Check if a part of the area lies inside of the clip rectangle, the drawing of invisible areas is skipped */
+bool WeatherDisplay::IsVisible(const PanelRect &rect)
+{
+   return rect.Intersects(ClipRect());
+}
+
+/* Area of a text in the current text size, datum is TL_DATUM, TC_DATUM or TR_DATUM */
+PanelRect WeatherDisplay::TextRect(const String &text, int x, int y, uint8_t datum)
+{
+   int w = canvas.textWidth(text);
+
+   if (datum == TC_DATUM) x -= w / 2;
+   if (datum == TR_DATUM) x -= w;
+   return PanelRect { x, y, w, 8 * textSize };
+}
+
+/* Draw a text at its top left corner, from the glyph atlas if possible */
+void WeatherDisplay::DrawString(const String &text, int x, int y)
+{
+   GlyphAtlas *atlas = textAtlas.Get(textSize);
+
+   if (!IsVisible(TextRect(text, x, y, TL_DATUM))) {
+      return;
+   }
+   x -= originX;
+   y -= originY;
+   if (atlas == NULL || !atlas->Draw(CanvasTarget(canvas), x, y, text)) {
+      canvas.drawString(text, x, y, 1);
+   }
+}
+
+/* Draw a text centered at x */
+void WeatherDisplay::DrawCentreString(const String &text, int x, int y)
+{
+   GlyphAtlas *atlas = textAtlas.Get(textSize);
+
+   if (!IsVisible(TextRect(text, x, y, TC_DATUM))) {
+      return;
+   }
+   x -= originX;
+   y -= originY;
+   if (atlas == NULL || !atlas->Draw(CanvasTarget(canvas), x - atlas->TextWidth(text) / 2, y, text)) {
+      canvas.drawCentreString(text, x, y, 1);
+   }
+}
+
+/* Draw a text that ends at x */
+void WeatherDisplay::DrawRightString(const String &text, int x, int y)
+{
+   GlyphAtlas *atlas = textAtlas.Get(textSize);
+
+   if (!IsVisible(TextRect(text, x, y, TR_DATUM))) {
+      return;
+   }
+   x -= originX;
+   y -= originY;
+   if (atlas == NULL || !atlas->Draw(CanvasTarget(canvas), x - atlas->TextWidth(text), y, text)) {
+      canvas.drawRightString(text, x, y, 1);
+   }
+}
+
+/* Draw a horizontal line of length pixels into the frame buffer */
+void WeatherDisplay::DrawHLine(int x, int y, int length, uint8_t gray)
+{
+   RasterTarget target = CanvasTarget(canvas);
+
+   x -= originX;
+   y -= originY;
+   if (target.IsValid()) {
+      target.HLine(x, y, length, gray);
+   } else {
+      canvas.drawFastHLine(x, y, length, gray);
+   }
+}
+
+/* Draw a vertical line of length pixels into the frame buffer */
+void WeatherDisplay::DrawVLine(int x, int y, int length, uint8_t gray)
+{
+   RasterTarget target = CanvasTarget(canvas);
+
+   x -= originX;
+   y -= originY;
+   if (target.IsValid()) {
+      target.VLine(x, y, length, gray);
+   } else {
+      canvas.drawFastVLine(x, y, length, gray);
+   }
+}
+
+/* Draw the outline of a rectangle into the frame buffer */
+void WeatherDisplay::DrawRect(int x, int y, int w, int h, uint8_t gray)
+{
+   RasterTarget target = CanvasTarget(canvas);
+
+   x -= originX;
+   y -= originY;
+   if (target.IsValid()) {
+      target.DrawRect(x, y, w, h, gray);
+   } else {
+      canvas.drawRect(x, y, w, h, gray);
+   }
+}
+
+/* Fill a rectangle in the frame buffer */
+void WeatherDisplay::FillRect(int x, int y, int w, int h, uint8_t gray)
+{
+   RasterTarget target = CanvasTarget(canvas);
+
+   x -= originX;
+   y -= originY;
+   if (target.IsValid()) {
+      target.FillRect(x, y, w, h, gray);
+   } else {
+      canvas.fillRect(x, y, w, h, gray);
+   }
+}
+
+/* Draw a line with the canvas function */
+void WeatherDisplay::DrawLine(int x0, int y0, int x1, int y1, uint8_t gray)
+{
+   if (!IsVisible(PanelRect { min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1 })) {
+      return;
+   }
+   canvas.drawLine(x0 - originX, y0 - originY, x1 - originX, y1 - originY, gray);
+}
+
+/* Fill a circle with the canvas function */
+void WeatherDisplay::FillCircle(int x, int y, int r, uint8_t gray)
+{
+   if (!IsVisible(PanelRect { x - r, y - r, 2 * r + 1, 2 * r + 1 })) {
+      return;
+   }
+   canvas.fillCircle(x - originX, y - originY, r, gray);
+}
+
+/* Fill a triangle with the canvas function */
+void WeatherDisplay::FillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t gray)
+{
+   int left = min(x0, min(x1, x2));
+   int top  = min(y0, min(y1, y2));
+
+   if (!IsVisible(PanelRect { left, top, max(x0, max(x1, x2)) - left + 1, max(y0, max(y1, y2)) - top + 1 })) {
+      return;
+   }
+   canvas.fillTriangle(x0 - originX, y0 - originY, x1 - originX, y1 - originY, x2 - originX, y2 - originY, gray);
+}
+
+/**
+  * Draw a circle with optional start and end point, the degrees run clockwise from the right.
+  * The midpoint circle points are drawn if they lie between the start and the end direction,
+  * full circles are drawn by the canvas.
+  */
 void WeatherDisplay::DrawCircle(int32_t x, int32_t y, int32_t r, uint32_t color, int32_t degFrom /* = 0 */, int32_t degTo /* = 360 */)
 {
-   for (int i = degFrom; i < degTo; i++) {
-      double radians = i * PI / 180;
-      double px      = x + r * cos(radians);
-      double py      = y + r * sin(radians);
-      
-      canvas.drawPixel(px, py, color);
+   int  fromX = FixedCos(TrigAngle(degFrom));
+   int  fromY = FixedSin(TrigAngle(degFrom));
+   int  toX   = FixedCos(TrigAngle(degTo));
+   int  toY   = FixedSin(TrigAngle(degTo));
+   bool full  = degTo - degFrom >= 360;
+   bool wide  = degTo - degFrom > 180;
+   int  px    = r;
+   int  py    = 0;
+   int  err   = 1 - r;
+
+   if (!IsVisible(PanelRect { x - r, y - r, 2 * r + 1, 2 * r + 1 })) {
+      return;
+   }
+   x -= originX;
+   y -= originY;
+   if (full) {
+      canvas.drawCircle(x, y, r, color);
+      return;
+   }
+   auto plot = [&](int dx, int dy) {
+      // the signs of the cross products tell the side of the start and the end direction
+      bool afterFrom = fromX * dy - fromY * dx >= 0;
+      bool beforeTo  = dx * toY - dy * toX > 0;
+
+      if (wide ? afterFrom || beforeTo : afterFrom && beforeTo) {
+         canvas.drawPixel(x + dx, y + dy, color);
+      }
+   };
+   while (px >= py) {
+      plot( px,  py); plot( py,  px); plot(-py,  px); plot(-px,  py);
+      plot(-px, -py); plot(-py, -px); plot( py, -px); plot( px, -py);
+      py++;
+      if (err < 0) {
+         err += 2 * py + 1;
+      } else {
+         px--;
+         err += 2 * (py - px) + 1;
+      }
    }
-} 
+}
 
 /* Draw a the rssi value as circle parts */
 void WeatherDisplay::DrawRSSI(int x, int y)
 {
    int iQuality = WifiGetRssiAsQualityInt(myData.wifiRSSI);
 
+   // the arcs open upwards from the center
+   if (!IsVisible(PanelRect { x - 4, y - 16, 33, 17 })) {
+      return;
+   }
    if (iQuality >= 80) DrawCircle(x + 12, y, 16, M5EPD_Canvas::G15, 225, 315); 
    if (iQuality >= 40) DrawCircle(x + 12, y, 12, M5EPD_Canvas::G15, 225, 315); 
    if (iQuality >= 20) DrawCircle(x + 12, y,  8, M5EPD_Canvas::G15, 225, 315); 
@@ -79,39 +393,121 @@ void WeatherDisplay::DrawRSSI(int x, int y)
 /* Draw a the battery icon */
 void WeatherDisplay::DrawBattery(int x, int y)
 {
-   canvas.drawRect(x, y, 40, 16, M5EPD_Canvas::G15);
-   canvas.drawRect(x + 40, y + 3, 4, 10, M5EPD_Canvas::G15);
-   for (int i = x; i < x + 40; i++) {
-      canvas.drawLine(i, y, i, y + 15, M5EPD_Canvas::G15);
-      if ((i - x) * 100.0 / 40.0 > myData.batteryCapacity) {
-         break;
-      }
+   int columns = 1; // filled up to the first column above the capacity
+
+   if (!IsVisible(PanelRect { x, y, 44, 16 })) {
+      return;
    }
+   while (columns < 40 && (columns - 1) * 100 <= myData.batteryCapacity * 40) {
+      columns++;
+   }
+   DrawRect(x, y, 40, 16, M5EPD_Canvas::G15);
+   DrawRect(x + 40, y + 3, 4, 10, M5EPD_Canvas::G15);
+   FillRect(x, y, columns, 16, M5EPD_Canvas::G15);
 }
 
 /* Draw a the head with version, city, rssi and battery */
-void WeatherDisplay::DrawHead()
+void WeatherDisplay::DrawHead(int x, int y, int dx, int dy)
 {
-   canvas.drawString(VERSION, 20, 10);
-   canvas.drawCentreString(CITY_NAME, maxX / 2, 10, 1);
-   canvas.drawString(WifiGetRssiAsQuality(myData.wifiRSSI) + "%", maxX - 200, 10);
-   DrawRSSI(maxX - 155, 25);
-   canvas.drawString(String(myData.batteryCapacity) + "%", maxX - 110, 10);
-   DrawBattery(maxX - 65, 10);
+   if (!IsVisible(PanelRect { x, y, dx, dy })) {
+      return;
+   }
+   if (StaticLayer()) {
+      DrawString(VERSION, x + 20, y + 10);
+      DrawCentreString(CITY_NAME, x + dx / 2, y + 10);
+   }
+   if (!DynamicLayer()) {
+      return;
+   }
+   DrawString(WifiGetRssiAsQuality(myData.wifiRSSI) + "%", x + dx - 200, y + 10);
+   DrawRSSI(x + dx - 155, y + 25);
+   DrawString(String(myData.batteryCapacity) + "%", x + dx - 110, y + 10);
+   DrawBattery(x + dx - 65, y + 10);
+}
+
+/* Draw one icon into a size x size box, the best generated size is centered in the box */
+void WeatherDisplay::DrawIcon(int x, int y, IconId id, int size, bool highContrast /*= false*/)
+{
+   if (!IsVisible(PanelRect { x, y, size, size })) {
+      return;
+   }
+#ifdef USE_VECTOR_ICONS
+   const uint8_t *path = GetVectorIcon(id);
+
+   if (path != NULL) {
+      DrawVectorIcon(canvas, x - originX, y - originY, size, path);
+      return;
+   }
+#endif
+   Icon icon = GetIcon(id, size);
+
+   DrawIcon(x + (size - icon.width) / 2, y + (size - icon.height) / 2, icon, highContrast);
 }
 
-/* Draw one icon from the binary data */
-void WeatherDisplay::DrawIcon(int x, int y, const uint16_t *icon, int dx /*= 64*/, int dy /*= 64*/, bool highContrast /*= false*/)
+/**
+  * Draw one icon, the rows are copied or expanded straight into the canvas frame buffer, high contrast uses the 1 bit mask.
+  * Rows outside of the canvas are skipped, icons reaching over the left or right canvas border use the canvas functions.
+  */
+void WeatherDisplay::DrawIcon(int x, int y, const Icon &icon, bool highContrast /*= false*/)
 {
-   for (int yi = 0; yi < dy; yi++) {
-      for (int xi = 0; xi < dx; xi++) {
-         uint16_t pixel = icon[yi * dx + xi];
+   RasterTarget   target = CanvasTarget(canvas);
+   const uint8_t *src    = icon.data;
+
+   if (!IsVisible(PanelRect { x, y, icon.width, icon.height })) {
+      return;
+   }
+   x -= originX;
+   y -= originY;
+
+   int  top    = max(0, -y);
+   int  bottom = min((int) icon.height, target.height - y);
+   bool direct = target.Contains(x, y + top, icon.width, bottom - top);
+
+   if (direct && highContrast && icon.mask != NULL) {
+      const uint8_t *mask = icon.mask + top * icon.width / 8;
 
-         if (highContrast) {
-            if (15 - (pixel / 4096) > 0) canvas.drawPixel(x + xi, y + yi, M5EPD_Canvas::G15);
-         } else {
-            canvas.drawPixel(x + xi, y + yi, 15 - (pixel / 4096));
+      for (int yi = top; yi < bottom; yi++, mask += icon.width / 8) {
+         BlitMaskRow4(target.Row(y + yi), x, mask, icon.width);
+      }
+      return;
+   }
+   if (direct && !highContrast && icon.format == ICON_PACKED4) {
+      target.Blit4(x, y + top, icon.data + top * icon.Stride(), icon.width, bottom - top);
+      return;
+   }
+   for (int yi = 0; yi < icon.height; yi++) {
+      // clipped icons and odd canvas widths fall back to the canvas functions
+      bool     visible = !direct || (yi >= top && yi < bottom);
+      uint8_t *row     = direct && visible ? target.Row(y + yi) : NULL;
+
+      if (icon.format == ICON_RLE4) {
+         src = ForEachRleRun(src, icon.width, [&](int xi, int length, uint8_t gray) {
+            if (!visible) return;
+            if (highContrast) {
+               if (gray == 0) return;
+               gray = M5EPD_Canvas::G15;
+            }
+            if (row) {
+               FillSpan4(row, x + xi, length, gray);
+            } else {
+               canvas.drawFastHLine(x + xi, y + yi, length, gray);
+            }
+         });
+      } else {
+         if (row) {
+            BlitRow4<true>(row, x, src, icon.width);
+         } else if (visible) {
+            for (int xi = 0; xi < icon.width; xi++) {
+               uint8_t pixel = icon.Pixel(xi, yi);
+
+               if (highContrast) {
+                  if (pixel > 0) canvas.drawPixel(x + xi, y + yi, M5EPD_Canvas::G15);
+               } else {
+                  canvas.drawPixel(x + xi, y + yi, pixel);
+               }
+            }
          }
+         src += icon.Stride();
       }
    }
 }
@@ -119,61 +515,53 @@ void WeatherDisplay::DrawIcon(int x, int y, const uint16_t *icon, int dx /*= 64*
 /* Draw the sun information with sunrise and sunset */
 void WeatherDisplay::DrawSunInfo(int x, int y, int dx, int dy)
 {
-   canvas.setTextSize(4);
-   canvas.drawCentreString("Sun", x + dx / 2, y + 9, 1);
-   canvas.drawLine(x, y + 42, x + dx, y + 42, M5EPD_Canvas::G15);
-
-   canvas.setTextSize(4);
-   DrawIcon(x + dx / 2 - 32, y + 55, (uint16_t *) SUNRISE64x64);
-   canvas.drawCentreString(getHourMinString(myData.weather.sunrise), x + dx / 2, y + 130, 1);
-   
-   DrawIcon(x + dx / 2 - 32, y + 170, (uint16_t *) SUNSET64x64);
-   canvas.drawCentreString(getHourMinString(myData.weather.sunset),  x + dx / 2, y + 245, 1);
+   if (!IsVisible(PanelRect { x, y, dx + 1, dy })) {
+      return;
+   }
+   SetTextSize(4);
+   if (StaticLayer()) {
+      DrawCentreString("Sun", x + dx / 2, y + 9);
+      DrawHLine(x, y + 42, dx + 1, M5EPD_Canvas::G15);
+      DrawIcon(x + dx / 2 - 32, y + 55, ICON_ID_SUNRISE, 64);
+      DrawIcon(x + dx / 2 - 32, y + 170, ICON_ID_SUNSET, 64);
+   }
+   if (DynamicLayer()) {
+      DrawCentreString(getHourMinString(myData.weather.sunrise), x + dx / 2, y + 130);
+      DrawCentreString(getHourMinString(myData.weather.sunset),  x + dx / 2, y + 245);
+   }
 }
 
 /* Draw current weather information */
 void WeatherDisplay::DrawWeatherInfo(int x, int y, int dx, int dy)
 {
-   canvas.setTextSize(4);
-   canvas.drawCentreString("Weather", x + dx / 2, y + 9, 1);
-   canvas.drawLine(x, y + 42, x + dx, y + 42, M5EPD_Canvas::G15);
-
-   String icon = myData.weather.hourlyIcon[0];
-   int iconX = x + dx / 2 - 32;
-   int iconY = y + 50;
-
-        if (icon == "01d") DrawIcon(iconX, iconY, (uint16_t *) image_data_01d, 64, 64, true);
-   else if (icon == "01n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "02d") DrawIcon(iconX, iconY, (uint16_t *) image_data_02d, 64, 64, true);
-   else if (icon == "02n") DrawIcon(iconX, iconY, (uint16_t *) image_data_02n, 64, 64, true);
-   else if (icon == "03d") DrawIcon(iconX, iconY, (uint16_t *) image_data_03d, 64, 64, true);
-   else if (icon == "03n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "04d") DrawIcon(iconX, iconY, (uint16_t *) image_data_04d, 64, 64, true);
-   else if (icon == "04n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "09d") DrawIcon(iconX, iconY, (uint16_t *) image_data_09d, 64, 64, true);
-   else if (icon == "09n") DrawIcon(iconX, iconY, (uint16_t *) image_data_09n, 64, 64, true);
-   else if (icon == "10d") DrawIcon(iconX, iconY, (uint16_t *) image_data_10d, 64, 64, true);
-   else if (icon == "10n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "11d") DrawIcon(iconX, iconY, (uint16_t *) image_data_11d, 64, 64, true);
-   else if (icon == "11n") DrawIcon(iconX, iconY, (uint16_t *) image_data_11n, 64, 64, true);
-   else if (icon == "13d") DrawIcon(iconX, iconY, (uint16_t *) image_data_13d, 64, 64, true);
-   else if (icon == "13n") DrawIcon(iconX, iconY, (uint16_t *) image_data_13n, 64, 64, true);
-   else if (icon == "50d") DrawIcon(iconX, iconY, (uint16_t *) image_data_50d, 64, 64, true);
-   else if (icon == "50n") DrawIcon(iconX, iconY, (uint16_t *) image_data_50n, 64, 64, true);
-   else DrawIcon(iconX, iconY, (uint16_t *) image_data_unknown, 64, 64, true);
-
-   canvas.drawCentreString(myData.weather.hourlyMain[0], x + dx / 2, y + 115, 1);
+   if (!IsVisible(PanelRect { x, y, dx + 1, dy })) {
+      return;
+   }
+   SetTextSize(4);
+   if (StaticLayer()) {
+      DrawCentreString("Weather", x + dx / 2, y + 9);
+      DrawHLine(x, y + 42, dx + 1, M5EPD_Canvas::G15);
+      DrawString("C", x + dx / 2 + 20, y + 170);
+   }
+   if (!DynamicLayer()) {
+      return;
+   }
+   IconId icon  = GetWeatherIcon(myData.weather.hourlyIcon[0]);
+   int    iconX = x + dx / 2 - 32;
+   int    iconY = y + 50;
+
+   DrawIcon(iconX, iconY, icon, 64, true);
+
+   DrawCentreString(myData.weather.hourlyMain[0], x + dx / 2, y + 115);
 
    // temp
-   canvas.setTextSize(7);
+   SetTextSize(7);
    char buff[8];
    sprintf(buff,"%.0f",myData.weather.hourlyMaxTemp[0]);
-   canvas.drawRightString(buff, x + dx / 2 + 20, y + 170, 1);
-   canvas.setTextSize(4);
-   canvas.drawString(      "C", x + dx / 2 + 20, y + 170, 1);
+   DrawRightString(buff, x + dx / 2 + 20, y + 170);
    // rain
-   canvas.setTextSize(4);
-   canvas.drawCentreString(getFloatString(myData.weather.hourlyRain[0], "mm"),  x + dx / 2, y + 240, 1);
+   SetTextSize(4);
+   DrawCentreString(getFloatString(myData.weather.hourlyRain[0], "mm"),  x + dx / 2, y + 240);
 }
 
 /* Draw the in the wind section
@@ -192,19 +580,22 @@ void WeatherDisplay::DrawWeatherInfo(int x, int y, int dx, int dy)
  */
 void WeatherDisplay::Arrow(int x, int y, int asize, float aangle, int pwidth, int plength) 
 {
-   float dx = (asize + 21) * cos((aangle - 90) * PI / 180) + x; // calculate X position
-   float dy = (asize + 21) * sin((aangle - 90) * PI / 180) + y; // calculate Y position
-   float x1 = 0;           float y1 = plength;
-   float x2 = pwidth / 2;  float y2 = pwidth / 2;
-   float x3 = -pwidth / 2; float y3 = pwidth / 2;
-   float angle = aangle * PI / 180;
-   float xx1 = x1 * cos(angle) - y1 * sin(angle) + dx;
-   float yy1 = y1 * cos(angle) + x1 * sin(angle) + dy;
-   float xx2 = x2 * cos(angle) - y2 * sin(angle) + dx;
-   float yy2 = y2 * cos(angle) + x2 * sin(angle) + dy;
-   float xx3 = x3 * cos(angle) - y3 * sin(angle) + dx;
-   float yy3 = y3 * cos(angle) + x3 * sin(angle) + dy;
-   canvas.fillTriangle(xx1, yy1, xx3, yy3, xx2, yy2, M5EPD_Canvas::G15);
+   int angle = (int) (aangle * TRIG_STEPS + 0.5f);
+   int c     = FixedCos(angle);
+   int s     = FixedSin(angle);
+   // fixed point tip position and corners, truncated to pixels at the end
+   int dx = (asize + 21) * FixedCos(angle - TrigAngle(90)) + (x << TRIG_SHIFT); // calculate X position
+   int dy = (asize + 21) * FixedSin(angle - TrigAngle(90)) + (y << TRIG_SHIFT); // calculate Y position
+   int x1 = 0;           int y1 = plength;
+   int x2 = pwidth / 2;  int y2 = pwidth / 2;
+   int x3 = -pwidth / 2; int y3 = pwidth / 2;
+   int xx1 = (x1 * c - y1 * s + dx) >> TRIG_SHIFT;
+   int yy1 = (y1 * c + x1 * s + dy) >> TRIG_SHIFT;
+   int xx2 = (x2 * c - y2 * s + dx) >> TRIG_SHIFT;
+   int yy2 = (y2 * c + x2 * s + dy) >> TRIG_SHIFT;
+   int xx3 = (x3 * c - y3 * s + dx) >> TRIG_SHIFT;
+   int yy3 = (y3 * c + x3 * s + dy) >> TRIG_SHIFT;
+   FillTriangle(xx1, yy1, xx3, yy3, xx2, yy2, M5EPD_Canvas::G15);
 }
 
 /* Draw the wind circle with the windspeed data
@@ -217,113 +608,154 @@ void WeatherDisplay::DisplayDisplayWindSection(int x, int y, float angle, float
 {
    int dxo, dyo, dxi, dyi;
 
-   canvas.setTextSize(3);
-   canvas.drawLine(0, 15, 0, y + cradius + 30, M5EPD_Canvas::G15);
-   canvas.drawCircle(x, y, cradius, M5EPD_Canvas::G15);     // Draw compass circle
-   canvas.drawCircle(x, y, cradius + 1, M5EPD_Canvas::G15); // Draw compass circle
-   canvas.drawCircle(x, y, cradius * 0.7, M5EPD_Canvas::G15); // Draw compass inner circle
-   for (float a = 0; a < 360; a = a + 22.5) {
-      dxo = cradius * cos((a - 90) * PI / 180);
-      dyo = cradius * sin((a - 90) * PI / 180);
-      if (a == 45)  canvas.drawCentreString("NE", dxo + x + 15, dyo + y - 15, 1);
-      if (a == 135) canvas.drawCentreString("SE", dxo + x + 15, dyo + y  + 5, 1);
-      if (a == 225) canvas.drawCentreString("SW", dxo + x - 15, dyo + y  + 5, 1);
-      if (a == 315) canvas.drawCentreString("NW", dxo + x - 15, dyo + y - 15, 1);
-      dxi = dxo * 0.9;
-      dyi = dyo * 0.9;
-      canvas.drawLine(dxo + x, dyo + y, dxi + x, dyi + y, M5EPD_Canvas::G15);
-      dxo = dxo * 0.7;
-      dyo = dyo * 0.7;
-      dxi = dxo * 0.9;
-      dyi = dyo * 0.9;
-      canvas.drawLine(dxo + x, dyo + y, dxi + x, dyi + y, M5EPD_Canvas::G15);
-   }
-   canvas.drawCentreString("N", x, y - cradius - 20, 1);
-   canvas.drawCentreString("S", x, y + cradius + 5, 1);
-   canvas.drawCentreString("W", x - cradius - 15, y - 3, 1);
-   canvas.drawCentreString("E", x + cradius + 15,  y - 3, 1);
-   canvas.setTextSize(4);
-   canvas.drawCentreString(String(windspeed, 1), x, y - 30, 1);
-   canvas.setTextSize(3);
-   canvas.drawCentreString("m/s", x, y + 10, 1);
-
-   Arrow(x, y, cradius - 10, angle, 23, 55);
+   SetTextSize(3);
+   // the compass with its labels
+   if (StaticLayer() && IsVisible(PanelRect { x - cradius - 30, y - cradius - 20, 2 * cradius + 61, 2 * cradius + 50 })) {
+      DrawCircle(x, y, cradius, M5EPD_Canvas::G15);     // Draw compass circle
+      DrawCircle(x, y, cradius + 1, M5EPD_Canvas::G15); // Draw compass circle
+      DrawCircle(x, y, cradius * 7 / 10, M5EPD_Canvas::G15); // Draw compass inner circle
+      for (int a = 0; a < TrigAngle(360); a += TrigAngle(45) / 2) {
+         dxo = cradius * FixedCos(a - TrigAngle(90)) / TRIG_ONE;
+         dyo = cradius * FixedSin(a - TrigAngle(90)) / TRIG_ONE;
+         if (a == TrigAngle(45))  DrawCentreString("NE", dxo + x + 15, dyo + y - 15);
+         if (a == TrigAngle(135)) DrawCentreString("SE", dxo + x + 15, dyo + y  + 5);
+         if (a == TrigAngle(225)) DrawCentreString("SW", dxo + x - 15, dyo + y  + 5);
+         if (a == TrigAngle(315)) DrawCentreString("NW", dxo + x - 15, dyo + y - 15);
+         dxi = dxo * 9 / 10;
+         dyi = dyo * 9 / 10;
+         DrawLine(dxo + x, dyo + y, dxi + x, dyi + y, M5EPD_Canvas::G15);
+         dxo = dxo * 7 / 10;
+         dyo = dyo * 7 / 10;
+         dxi = dxo * 9 / 10;
+         dyi = dyo * 9 / 10;
+         DrawLine(dxo + x, dyo + y, dxi + x, dyi + y, M5EPD_Canvas::G15);
+      }
+      DrawCentreString("N", x, y - cradius - 20);
+      DrawCentreString("S", x, y + cradius + 5);
+      DrawCentreString("W", x - cradius - 15, y - 3);
+      DrawCentreString("E", x + cradius + 15,  y - 3);
+      DrawCentreString("m/s", x, y + 10);
+   }
+   if (DynamicLayer()) {
+      SetTextSize(4);
+      DrawCentreString(String(windspeed, 1), x, y - 30);
+      SetTextSize(3);
+
+      Arrow(x, y, cradius - 10, angle, 23, 55);
+   }
 }
 
 /* Draw the wind information part */
 void WeatherDisplay::DrawWindInfo(int x, int y, int dx, int dy)
 {
-   canvas.setTextSize(4);
-   canvas.drawCentreString("Wind", x + dx / 2, y + 9, 1);
-   canvas.drawLine(x, y + 42, x + dx, y + 42, M5EPD_Canvas::G15);
+   float winddir   = 0;
+   float windspeed = 0;
+   int   centerY   = y + dy / 2 + 20;
+   int   radius    = 95;
+
+   // the static layer reads no weather data, Prepare() draws it during the fetch
+   if (DynamicLayer()) {
+      winddir   = myData.weather.winddir;
+      windspeed = myData.weather.windspeed;
+   }
+   // the line at the left edge of the display lies outside of the panel
+   if (StaticLayer()) {
+      DrawVLine(0, 15, centerY + radius + 16, M5EPD_Canvas::G15);
+   }
+   if (!IsVisible(PanelRect { x, y, dx + 1, dy })) {
+      return;
+   }
+   SetTextSize(4);
+   if (StaticLayer()) {
+      DrawCentreString("Wind", x + dx / 2, y + 9);
+      DrawHLine(x, y + 42, dx + 1, M5EPD_Canvas::G15);
+   }
 
-   DisplayDisplayWindSection(x + dx / 2, y + dy / 2 + 20, myData.weather.winddir, myData.weather.windspeed, 95);
+   DisplayDisplayWindSection(x + dx / 2, centerY, winddir, windspeed, radius);
 }
 
 /* Draw the M5Paper environment and RTC information */
 void WeatherDisplay::DrawM5PaperInfo(int x, int y, int dx, int dy)
 {
-   canvas.setTextSize(4);
-   canvas.drawCentreString("Indoor", x + dx / 2, y + 9, 1);
-   canvas.drawLine(x, y + 42, x + dx, y + 42, M5EPD_Canvas::G15);
-
-   canvas.setTextSize(4);
-   canvas.drawCentreString(getRTCDateString(), x + dx / 2, y + 55, 1);
-   canvas.drawCentreString(getRTCTimeString(), x + dx / 2, y + 95, 1);
-   canvas.setTextSize(3);
-   canvas.drawCentreString("updated", x + dx / 2, y + 130, 1);
-
-   DrawIcon(x + dx / 4 - 32, y + 170, (uint16_t *) TEMPERATURE64x64);
-   canvas.setTextSize(7);
-   canvas.drawRightString(String(myData.sht30Temperatur - 2), x + dx / 4 + 30, y + 240, 1);
-   canvas.setTextSize(4);
-   canvas.drawString("C", x + dx / 4 + 30, y + 240, 1);
-
-   DrawIcon(x + dx / 4 * 3 - 40, y + 170, (uint16_t *) HUMIDITY64x64);
-   canvas.setTextSize(7);
-   canvas.drawRightString(String(myData.sht30Humidity), x + dx / 4 * 3 + 20, y + 240, 1);
-   canvas.setTextSize(4);
-   canvas.drawString("%", x + dx / 4 * 3 + 20, y + 240, 1);
-   
+   if (!IsVisible(PanelRect { x, y, dx + 1, dy })) {
+      return;
+   }
+   if (StaticLayer()) {
+      SetTextSize(4);
+      DrawCentreString("Indoor", x + dx / 2, y + 9);
+      DrawHLine(x, y + 42, dx + 1, M5EPD_Canvas::G15);
+      SetTextSize(3);
+      DrawCentreString("updated", x + dx / 2, y + 130);
+
+      DrawIcon(x + dx / 4 - 32, y + 170, ICON_ID_TEMPERATURE, 64);
+      DrawIcon(x + dx / 4 * 3 - 40, y + 170, ICON_ID_HUMIDITY, 64);
+      SetTextSize(4);
+      DrawString("C", x + dx / 4 + 30, y + 240);
+      DrawString("%", x + dx / 4 * 3 + 20, y + 240);
+   }
+   if (DynamicLayer()) {
+      // the humidity may reach over the static "C"
+      DrawInfoField(INFO_DATE, x, y, dx);
+      DrawInfoField(INFO_TIME, x, y, dx);
+      DrawInfoField(INFO_TEMPERATURE, x, y, dx);
+      DrawInfoField(INFO_HUMIDITY, x, y, dx);
+   }
+}
+
+/* Text and area of a changing text of the M5Paper info, selects the text size of the field */
+PanelRect WeatherDisplay::GetInfoField(InfoField field, int x, int y, int dx, String &text)
+{
+   switch (field) {
+   case INFO_DATE:
+      SetTextSize(4);
+      text = getRTCDateString();
+      return TextRect(text, x + dx / 2, y + 55, TC_DATUM);
+   case INFO_TIME:
+      SetTextSize(4);
+      text = getRTCTimeString();
+      return TextRect(text, x + dx / 2, y + 95, TC_DATUM);
+   case INFO_TEMPERATURE:
+      SetTextSize(7);
+      text = String(myData.sht30Temperatur - 2);
+      return TextRect(text, x + dx / 4 + 30, y + 240, TR_DATUM);
+   default:
+      SetTextSize(7);
+      text = String(myData.sht30Humidity);
+      return TextRect(text, x + dx / 4 * 3 + 20, y + 240, TR_DATUM);
+   }
+}
+
+/* Draw a changing text of the M5Paper info */
+void WeatherDisplay::DrawInfoField(InfoField field, int x, int y, int dx)
+{
+   String    text;
+   PanelRect rect = GetInfoField(field, x, y, dx, text);
+
+   DrawString(text, rect.x, rect.y);
 }
 
 /* Draw one daily weather information */
 void WeatherDisplay::DrawDaily(int x, int y, int dx, int dy, Weather &weather, int index)
 {
+   if (!DynamicLayer() || !IsVisible(PanelRect { x, y, dx, dy })) {
+      return;
+   }
    time_t time = weather.forecastTime[index];
    int    tMin = weather.forecastMinTemp[index];
    int    tMax = weather.forecastMaxTemp[index];
    int    pop  = weather.forecastPop[index];
-   String icon = weather.forecastIcon[index];
-   
-   canvas.setTextSize(3);
-   canvas.drawCentreString(index == 0 ? "Today" : getShortDayOfWeekString(time), x + dx / 2, y + 5, 1);
 
-   int iconX = x + dx / 2 - 32;
-   int iconY = y + 33;
+   SetTextSize(3);
+   DrawCentreString(index == 0 ? "Today" : getShortDayOfWeekString(time), x + dx / 2, y + 5);
+
+   IconId icon  = GetWeatherIcon(weather.forecastIcon[index]);
+   int    iconX = x + dx / 2 - 32;
+   int    iconY = y + 33;
    
-        if (icon == "01d") DrawIcon(iconX, iconY, (uint16_t *) image_data_01d, 64, 64, true);
-   else if (icon == "01n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "02d") DrawIcon(iconX, iconY, (uint16_t *) image_data_02d, 64, 64, true);
-   else if (icon == "02n") DrawIcon(iconX, iconY, (uint16_t *) image_data_02n, 64, 64, true);
-   else if (icon == "03d") DrawIcon(iconX, iconY, (uint16_t *) image_data_03d, 64, 64, true);
-   else if (icon == "03n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "04d") DrawIcon(iconX, iconY, (uint16_t *) image_data_04d, 64, 64, true);
-   else if (icon == "04n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "09d") DrawIcon(iconX, iconY, (uint16_t *) image_data_09d, 64, 64, true);
-   else if (icon == "09n") DrawIcon(iconX, iconY, (uint16_t *) image_data_09n, 64, 64, true);
-   else if (icon == "10d") DrawIcon(iconX, iconY, (uint16_t *) image_data_10d, 64, 64, true);
-   else if (icon == "10n") DrawIcon(iconX, iconY, (uint16_t *) image_data_03n, 64, 64, true);
-   else if (icon == "11d") DrawIcon(iconX, iconY, (uint16_t *) image_data_11d, 64, 64, true);
-   else if (icon == "11n") DrawIcon(iconX, iconY, (uint16_t *) image_data_11n, 64, 64, true);
-   else if (icon == "13d") DrawIcon(iconX, iconY, (uint16_t *) image_data_13d, 64, 64, true);
-   else if (icon == "13n") DrawIcon(iconX, iconY, (uint16_t *) image_data_13n, 64, 64, true);
-   else if (icon == "50d") DrawIcon(iconX, iconY, (uint16_t *) image_data_50d, 64, 64, true);
-   else if (icon == "50n") DrawIcon(iconX, iconY, (uint16_t *) image_data_50n, 64, 64, true);
-   else DrawIcon(iconX, iconY, (uint16_t *) image_data_unknown, 64, 64, true);
-
-   canvas.drawCentreString(String(tMin)+"/"+String(tMax), x + dx / 2, y + 100, 1);
-   canvas.drawCentreString(String(pop)+"%", x + dx / 2, y + 135, 1);
+   DrawIcon(iconX, iconY, icon, 64, true);
+
+   DrawCentreString(String(tMin)+"/"+String(tMax), x + dx / 2, y + 100);
+   DrawCentreString(String(pop)+"%", x + dx / 2, y + 135);
 }
 
 /* Draw a graph with x- and y-axis and values */
@@ -331,7 +763,7 @@ void WeatherDisplay::DrawGraph(int x, int y, int dx, int dy, String title, int x
 {
    String yMinString = String(yMin);
    String yMaxString = String(yMax);
-   int    textWidth  = 5 + max(yMinString.length() * 3.5, yMaxString.length() * 3.5);
+   int    textWidth  = 5 + max(yMinString.length(), yMaxString.length()) * 7 / 2;
    int    graphX     = x + 5 + textWidth + 5;
    int    graphY     = y + 35;
    int    graphDX    = dx - textWidth - 20;
@@ -341,26 +773,29 @@ void WeatherDisplay::DrawGraph(int x, int y, int dx, int dy, String title, int x
    int    iOldX      = 0;
    int    iOldY      = 0;
 
-   canvas.setTextSize(3);
-   canvas.drawCentreString(title, x + dx / 2, y + 10, 1);
-   canvas.setTextSize(2);
-   canvas.drawString(yMaxString, x + 5, graphY - 5);   
-   canvas.drawString(yMinString, x + 5, graphY + graphDY - 3);   
+   // the x labels reach one row below the area
+   if (!DynamicLayer() || !IsVisible(PanelRect { x, y, dx, dy + 1 })) {
+      return;
+   }
+   SetTextSize(3);
+   DrawCentreString(title, x + dx / 2, y + 10);
+   SetTextSize(2);
+   DrawString(yMaxString, x + 5, graphY - 5);   
+   DrawString(yMinString, x + 5, graphY + graphDY - 3);   
    for (int i = 0; i <= xMax; i++) {
-      canvas.drawString(String(i), graphX + i * xStep, graphY + graphDY + 5);   
+      DrawString(String(i), graphX + i * xStep, graphY + graphDY + 5);   
    }
    
-   canvas.drawRect(graphX, graphY, graphDX, graphDY, M5EPD_Canvas::G15);   
+   DrawRect(graphX, graphY, graphDX, graphDY, M5EPD_Canvas::G15);   
    if (yMin < 0 && yMax > 0) { // null line?
-      float yValueDX = (float) graphDY / (yMax - yMin);
-      int   yPos     = graphY + graphDY - (0.0 - yMin) * yValueDX;
+      int yPos = graphY + yMax * graphDY / (yMax - yMin);
 
       if (yPos > graphY + graphDY) yPos = graphY + graphDY;
       if (yPos < graphY)           yPos = graphY;
 
-      canvas.drawString("0", graphX - 20, yPos);   
+      DrawString("0", graphX - 20, yPos);   
       for (int xDash = graphX; xDash < graphX + graphDX - 10; xDash += 10) {
-         canvas.drawLine(xDash, yPos, xDash + 5, yPos, M5EPD_Canvas::G15);         
+         DrawHLine(xDash, yPos, 6, M5EPD_Canvas::G15);         
       }
    }
    for (int i = xMin; i <= xMax; i++) {
@@ -372,9 +807,9 @@ void WeatherDisplay::DrawGraph(int x, int y, int dx, int dy, String title, int x
       if (yPos > graphY + graphDY) yPos = graphY + graphDY;
       if (yPos < graphY)           yPos = graphY;
 
-      canvas.fillCircle(xPos, yPos, 2, M5EPD_Canvas::G15);
+      FillCircle(xPos, yPos, 2, M5EPD_Canvas::G15);
       if (i > xMin) {
-         canvas.drawLine(iOldX, iOldY, xPos, yPos, M5EPD_Canvas::G15);         
+         DrawLine(iOldX, iOldY, xPos, yPos, M5EPD_Canvas::G15);         
       }
       iOldX = xPos;
       iOldY = yPos;
@@ -390,11 +825,11 @@ void WeatherDisplay::DrawGraph(int x, int y, int dx, int dy, String title, int x
          if (yPos < graphY)           yPos = graphY;
 
          if (i > xMin) {
-            canvas.drawLine(iOldX, iOldY, xPos, yPos, M5EPD_Canvas::G15);         
-            canvas.drawLine(iOldX, iOldY+1, xPos, yPos+1, M5EPD_Canvas::G0);         
+            DrawLine(iOldX, iOldY, xPos, yPos, M5EPD_Canvas::G15);         
+            DrawLine(iOldX, iOldY+1, xPos, yPos+1, M5EPD_Canvas::G0);         
          }
-         canvas.fillCircle(xPos, yPos, 3, M5EPD_Canvas::G15);
-         canvas.fillCircle(xPos, yPos, 2, M5EPD_Canvas::G0);
+         FillCircle(xPos, yPos, 3, M5EPD_Canvas::G15);
+         FillCircle(xPos, yPos, 2, M5EPD_Canvas::G0);
          iOldX = xPos;
          iOldY = yPos;
       }
@@ -406,7 +841,7 @@ void WeatherDisplay::DrawDualGraph(int x, int y, int dx, int dy, String title, i
 {
    String yMinString = String(yMinB);
    String yMaxString = String(yMaxB);
-   int    textWidth  = 5 + max(yMinString.length() * 3.5, yMaxString.length() * 3.5);
+   int    textWidth  = 5 + max(yMinString.length(), yMaxString.length()) * 7 / 2;
    int    graphX     = x + 5 + textWidth + 5;
    int    graphY     = y + 35;
    int    graphDX    = dx - textWidth - 20;
@@ -416,26 +851,29 @@ void WeatherDisplay::DrawDualGraph(int x, int y, int dx, int dy, String title, i
    int    iOldX      = 0;
    int    iOldY      = 0;
 
-   canvas.setTextSize(2);
-   canvas.drawCentreString(title, x + dx / 2, y + 10, 1);
-   canvas.setTextSize(2);
-   canvas.drawString(yMaxString, x + 5, graphY - 5);   
-   canvas.drawString(yMinString, x + 5, graphY + graphDY - 3);   
+   // the x labels reach one row below the area
+   if (!DynamicLayer() || !IsVisible(PanelRect { x, y, dx, dy + 1 })) {
+      return;
+   }
+   SetTextSize(2);
+   DrawCentreString(title, x + dx / 2, y + 10);
+   SetTextSize(2);
+   DrawString(yMaxString, x + 5, graphY - 5);   
+   DrawString(yMinString, x + 5, graphY + graphDY - 3);   
    for (int i = 0; i <= xMax; i++) {
-      canvas.drawString(String(i), graphX + i * xStep, graphY + graphDY + 5);   
+      DrawString(String(i), graphX + i * xStep, graphY + graphDY + 5);   
    }
    
-   canvas.drawRect(graphX, graphY, graphDX, graphDY, M5EPD_Canvas::G15);   
+   DrawRect(graphX, graphY, graphDX, graphDY, M5EPD_Canvas::G15);   
    if (yMin < 0 && yMax > 0) { // null line?
-      float yValueDX = (float) graphDY / (yMax - yMin);
-      int   yPos     = graphY + graphDY - (0.0 - yMin) * yValueDX;
+      int yPos = graphY + yMax * graphDY / (yMax - yMin);
 
       if (yPos > graphY + graphDY) yPos = graphY + graphDY;
       if (yPos < graphY)           yPos = graphY;
 
-      canvas.drawString("0", graphX - 20, yPos);   
+      DrawString("0", graphX - 20, yPos);   
       for (int xDash = graphX; xDash < graphX + graphDX - 10; xDash += 10) {
-         canvas.drawLine(xDash, yPos, xDash + 5, yPos, M5EPD_Canvas::G15);         
+         DrawHLine(xDash, yPos, 6, M5EPD_Canvas::G15);         
       }
    }
    for (int i = xMin; i < xMax; i++) {
@@ -450,7 +888,7 @@ void WeatherDisplay::DrawDualGraph(int x, int y, int dx, int dy, String title, i
       int width = graphDX / (xMax - xMin);
       int height = (graphY + graphDY) - yPos;
       if (height > 0) {
-         canvas.fillRect(xPos, yPos, width, height, M5EPD_Canvas::G15);
+         FillRect(xPos, yPos, width, height, M5EPD_Canvas::G15);
       }
    }
    for (int i = xMin + offset; i <= xMax; i++) {
@@ -463,98 +901,565 @@ void WeatherDisplay::DrawDualGraph(int x, int y, int dx, int dy, String title, i
       if (yPos < graphY)           yPos = graphY;
 
       if (i > xMin + offset) {
-         canvas.drawLine(iOldX, iOldY,   xPos, yPos,   M5EPD_Canvas::G15);
-         canvas.drawLine(iOldX, iOldY+1, xPos, yPos+1, M5EPD_Canvas::G0);
+         DrawLine(iOldX, iOldY,   xPos, yPos,   M5EPD_Canvas::G15);
+         DrawLine(iOldX, iOldY+1, xPos, yPos+1, M5EPD_Canvas::G0);
       }
-      canvas.fillCircle(xPos, yPos, 3, M5EPD_Canvas::G0);
-      canvas.fillCircle(xPos, yPos, 2, M5EPD_Canvas::G15);
+      FillCircle(xPos, yPos, 3, M5EPD_Canvas::G0);
+      FillCircle(xPos, yPos, 2, M5EPD_Canvas::G15);
       iOldX = xPos;
       iOldY = yPos;
    }
 }
 
-/* Main function to show all the data to the e-paper */
-void WeatherDisplay::Show()
+/* Draw one panel into its box of the layout */
+void WeatherDisplay::DrawPanel(PanelId panel, const PanelRect &box)
 {
-   Serial.println("WeatherDisplay::Show");
+   switch (panel) {
+   case PANEL_HEAD:    DrawHead       (box.x, box.y, box.w, box.h); break;
+   case PANEL_WEATHER: DrawWeatherInfo(box.x, box.y, box.w, box.h); break;
+   case PANEL_SUN:     DrawSunInfo    (box.x, box.y, box.w, box.h); break;
+   case PANEL_WIND:    DrawWindInfo   (box.x, box.y, box.w, box.h); break;
+   case PANEL_INDOOR:  DrawM5PaperInfo(box.x, box.y, box.w, box.h); break;
+   case PANEL_GRAPH:
+      if (!DynamicLayer()) {
+         break; // the graph has no static parts, the static layer reads no weather data
+      }
+      DrawDualGraph(box.x, box.y, box.w, box.h, "Rain 7days (mm/%)", 0,  7,   0,  100, myData.weather.forecastPop, 0, 0, myData.weather.forecastMaxRain, myData.weather.forecastRain);
+      break;
+   default:
+      DrawDaily(box.x, box.y, box.w, box.h, myData.weather, panel - PANEL_DAILY0);
+      break;
+   }
+// some graphs disabled to gain screen space, leaving here for reference
+//   canvas.drawRect(15, 408, maxX - 30, 122, M5EPD_Canvas::G15);
+//   DrawGraph( 15, 408, 232, 122, "Temp 12h (C)", 0, 12, myData.weather.hourlyTempRange[0], myData.weather.hourlyTempRange[1], myData.weather.hourlyMaxTemp, NULL);
+//   DrawDualGraph(247, 408, 232, 122, "Rain 12h (mm/%)", 0, 12,   0,  100, myData.weather.hourlyPop, 1, 0, myData.weather.hourlyMaxRain, myData.weather.hourlyRain);
+//   canvas.drawLine(480, 408, 480, 530, M5EPD_Canvas::G15);
+//   DrawGraph(481, 408, 232, 122, "Temp 7days (C)", 0,  7, myData.weather.forecastTempRange[0], myData.weather.forecastTempRange[1], myData.weather.forecastMinTemp, myData.weather.forecastMaxTemp);
+}
+
+/* Draw the given panels of the current layers in the order of the layout, the borders are drawn in both layers */
+void WeatherDisplay::DrawLayout(const bool draw[PANEL_COUNT])
+{
+   SetTextSize(3);
+   canvas.setTextDatum(TL_DATUM);
+
+   for (int i = 0; i < layout.count; i++) {
+      const LayoutItem &item = layout.items[i];
+
+      if (item.panel == PANEL_COUNT) {
+         DrawRect(item.rect.x, item.rect.y, item.rect.w, item.rect.h, M5EPD_Canvas::G15);
+      } else if (draw[item.panel]) {
+         DrawPanel(item.panel, layout.boxes[item.panel]);
+      }
+   }
+}
+
+/**
+  * Draw the given panels of the current layers into the canvas with the regions of the layout in parallel.
+  * Every region gets its own canvas with the content of the main canvas, draws everything that reaches into it
+  * and copies the result back. Regions without drawn panels keep the content of the main canvas.
+  */
+void WeatherDisplay::DrawRegions(const bool draw[PANEL_COUNT])
+{
+#ifdef PARALLEL_RENDER
+   RasterTarget frame = CanvasTarget(canvas);
+
+   textAtlas.Prepare();
+   RunParallel(layout.regionCount, PARALLEL_RENDER, [&](int index) {
+      const PanelRect &region = layout.regions[index];
+      bool             used   = false;
+
+      for (int i = 0; i < PANEL_COUNT; i++) {
+         used = used || (draw[i] && layout.rects[i].Intersects(region));
+      }
+      if (!used) {
+         return;
+      }
+      M5EPD_Canvas   target(&M5.EPD);
+      WeatherDisplay worker(*this, target);
+
+      target.createCanvas(region.w, region.h);
+      target.setTextColor(WHITE, BLACK);
+
+      RasterTarget part = CanvasTarget(target);
+
+      for (int y = 0; y < region.h; y++) {
+         memcpy(part.Row(y), frame.Row(region.y + y) + region.x / 2, region.w / 2);
+      }
+      worker.originX = region.x;
+      worker.originY = region.y;
+      worker.DrawLayout(draw);
+      for (int y = 0; y < region.h; y++) {
+         memcpy(frame.Row(region.y + y) + region.x / 2, part.Row(y), region.w / 2);
+      }
+      target.deleteCanvas();
+   });
+#else
+   DrawLayout(draw);
+#endif
+}
+
+/**
+  * Render the region index of the layout alone into the target canvas, which gets the size of the region.
+  * The region starts white and gets all panels and borders of the current layers that reach into it.
+  */
+void WeatherDisplay::DrawRegion(int index, M5EPD_Canvas &target)
+{
+   const PanelRect &region = layout.regions[index];
+   WeatherDisplay   worker(*this, target);
+   bool             all[PANEL_COUNT];
+
+   std::fill(all, all + PANEL_COUNT, true);
+   target.createCanvas(region.w, region.h);
+   target.setTextColor(WHITE, BLACK);
+   target.fillCanvas(0);
+   worker.originX = region.x;
+   worker.originY = region.y;
+   worker.DrawLayout(all);
+}
+
+/* Hash the inputs of the indoor panel, which need no network data */
+uint32_t WeatherDisplay::GetIndoorHash()
+{
+   return PanelHash().Add(getRTCDateString()).Add(getRTCTimeString()).Add(myData.sht30Temperatur).Add(myData.sht30Humidity).Get();
+}
+
+/* Hash the inputs of every panel of Show() */
+void WeatherDisplay::GetPanelHashes(uint32_t hash[PANEL_COUNT])
+{
+   Weather  &weather = myData.weather;
+   PanelHash graph;
+
+   hash[PANEL_HEAD]    = PanelHash().Add(VERSION).Add(CITY_NAME).Add(WifiGetRssiAsQualityInt(myData.wifiRSSI)).Add(myData.batteryCapacity).Get();
+   hash[PANEL_WEATHER] = PanelHash().Add(weather.hourlyIcon[0]).Add(weather.hourlyMain[0]).Add(weather.hourlyMaxTemp[0]).Add(weather.hourlyRain[0]).Get();
+   hash[PANEL_SUN]     = PanelHash().Add(weather.sunrise).Add(weather.sunset).Get();
+   hash[PANEL_WIND]    = PanelHash().Add(weather.winddir).Add(weather.windspeed).Get();
+   hash[PANEL_INDOOR]  = GetIndoorHash();
+   for (int i = 0; i <= 4; i++) {
+      hash[PANEL_DAILY0 + i] = PanelHash().Add(i == 0 ? String("Today") : getShortDayOfWeekString(weather.forecastTime[i]))
+                                          .Add(weather.forecastIcon[i])
+                                          .Add((int) weather.forecastMinTemp[i])
+                                          .Add((int) weather.forecastMaxTemp[i])
+                                          .Add((int) weather.forecastPop[i]).Get();
+   }
+   graph.Add(weather.forecastMaxRain);
+   for (int i = 0; i <= 7; i++) {
+      graph.Add(weather.forecastPop[i]).Add(weather.forecastRain[i]);
+   }
+   hash[PANEL_GRAPH] = graph.Get();
+}
+
+/* Copy an area aligned to 4 pixels out of the canvas and update only this area of the e-paper */
+void WeatherDisplay::PushRect(const PanelRect &rect, m5epd_update_mode_t mode)
+{
+   RasterTarget source = CanvasTarget(canvas);
+   int          stride = rect.w / 2;
+   uint8_t     *buffer = (uint8_t *) ps_malloc(stride * rect.h);
+
+   if (buffer != NULL) {
+      for (int y = 0; y < rect.h; y++) {
+         memcpy(buffer + y * stride, source.Row(rect.y + y) + rect.x / 2, stride);
+      }
+      M5.EPD.WritePartGram4bpp(rect.x, rect.y, rect.w, rect.h, buffer);
+      free(buffer);
+   } else {
+      // no memory for the copy, write the rows straight from the canvas
+      for (int y = 0; y < rect.h; y++) {
+         M5.EPD.WritePartGram4bpp(rect.x, rect.y + y, rect.w, 1, source.Row(rect.y + y) + rect.x / 2);
+      }
+   }
+   M5.EPD.UpdateArea(rect.x, rect.y, rect.w, rect.h, mode);
+}
+
+/* Id of the stored static layer, the layer of another layout, version or city is drawn again */
+uint32_t WeatherDisplay::GetBackgroundId()
+{
+   return PanelHash().Add(PANEL_LAYOUT_VERSION).Add(VERSION).Add(CITY_NAME).Add(maxX).Add(maxY).Get();
+}
+
+/* Copy the static layer from the flash into the canvas, it is drawn and stored if it is missing */
+void WeatherDisplay::LoadBackground()
+{
+   if (!LoadFrame((uint8_t *) canvas.frameBuffer(), maxX * maxY / 2, GetBackgroundId(), BACKGROUND_FILE)) {
+      bool all[PANEL_COUNT];
+
+      std::fill(all, all + PANEL_COUNT, true);
+      canvas.fillCanvas(0);
+      layers = LAYER_STATIC;
+      DrawLayout(all);
+      layers = LAYER_ALL;
+      SaveFrame((const uint8_t *) canvas.frameBuffer(), maxX * maxY / 2, GetBackgroundId(), BACKGROUND_FILE);
+   }
+}
+
+/* Load the frame of the last wake into a new buffer, NULL if it is not stored */
+uint8_t *WeatherDisplay::LoadPreviousFrame()
+{
+   size_t   size     = maxX * maxY / 2;
+   uint8_t *previous = (uint8_t *) ps_malloc(size);
+
+   if (previous != NULL && !LoadFrame(previous, size, myData.panels.frame)) {
+      free(previous);
+      previous = NULL;
+   }
+   return previous;
+}
+
+/**
+  * Push the changes of the pushed panels. With the frame of the last wake only the changed
+  * areas are updated, without it or for invalidated panels the whole panel.
+  * The update mode follows the content of every area, the panels to clean are updated
+  * completely with GC16 and their count of partial updates starts again.
+  */
+void WeatherDisplay::PushChanges(const uint8_t *previous, const bool push[PANEL_COUNT], const bool clean[PANEL_COUNT], const bool draw[PANEL_COUNT], const PanelRect rects[PANEL_COUNT])
+{
+   RasterTarget current = CanvasTarget(canvas);
+   FrameDiff    diff;
+   bool         partial[PANEL_COUNT] = {};
+   int          modes[UPDATE_MODE_NONE] = {};
+
+   // the canvas shows only the background in the panels that are not drawn
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      if (!draw[i]) {
+         diff.Keep(rects[i]);
+      }
+   }
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      if (!push[i] || clean[i]) {
+         continue;
+      }
+      if (previous != NULL && myData.panels.hash[i] != 0) {
+         diff.Compare(current, previous, rects[i].Aligned());
+      } else {
+         diff.AddRect(rects[i].Aligned());
+      }
+   }
+   diff.Merge();
+   for (int i = 0; i < diff.Count(); i++) {
+      const uint8_t *displayed = previous;
+
+      // the stored frame does not show the invalidated panels
+      for (int j = 0; j < PANEL_COUNT; j++) {
+         if (myData.panels.hash[j] == 0 && diff[i].Intersects(rects[j])) {
+            displayed = NULL;
+         }
+      }
+      m5epd_update_mode_t mode = SelectUpdateMode(current.buffer, displayed, current.stride, diff[i]);
+
+      PushRect(diff[i], mode);
+      modes[mode]++;
+      for (int j = 0; j < PANEL_COUNT; j++) {
+         partial[j] = partial[j] || (mode != UPDATE_MODE_GC16 && diff[i].Intersects(rects[j]));
+      }
+   }
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      if (clean[i]) {
+         PushRect(rects[i].Aligned(), UPDATE_MODE_GC16);
+         modes[UPDATE_MODE_GC16]++;
+         myData.panels.partial[i] = 0;
+      } else if (partial[i] && myData.panels.partial[i] < 255) {
+         myData.panels.partial[i]++;
+      }
+   }
+   Serial.println("Updated areas: GC16 " + String(modes[UPDATE_MODE_GC16]) + ", GL16 " + String(modes[UPDATE_MODE_GL16]) +
+                  ", DU " + String(modes[UPDATE_MODE_DU]) + ", A2 " + String(modes[UPDATE_MODE_A2]));
+}
+
+/**
+  * Store the displayed frame for the next wake and free the previous frame.
+  * Without previous frame the canvas has to contain all panels.
+  */
+void WeatherDisplay::StoreFrame(uint8_t *previous, const bool push[PANEL_COUNT], const PanelRect rects[PANEL_COUNT])
+{
+   RasterTarget current = CanvasTarget(canvas);
+   uint8_t     *frame   = previous != NULL ? previous : current.buffer;
+   uint32_t     id      = myData.panels.frame + 1;
+
+   for (int i = 0; previous != NULL && i < PANEL_COUNT; i++) {
+      PanelRect rect = rects[i].Aligned();
+
+      for (int y = rect.y; push[i] && y < rect.y + rect.h; y++) {
+         memcpy(previous + y * current.stride + rect.x / 2, current.Row(y) + rect.x / 2, rect.w / 2);
+      }
+   }
+   myData.panels.frame = SaveFrame(frame, current.stride * current.height, id) ? id : 0;
+   free(previous);
+}
 
-   canvas.createCanvas(960, 540);
+/* Update the pushed panels, the image memory of the EPD already holds the drawn bands */
+void WeatherDisplay::UpdatePanels(const m5epd_update_mode_t modes[PANEL_COUNT], const bool push[PANEL_COUNT], const bool clean[PANEL_COUNT], const PanelRect rects[PANEL_COUNT])
+{
+   int counts[UPDATE_MODE_NONE] = {};
 
-   canvas.setTextSize(3);
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      if (!push[i]) {
+         continue;
+      }
+      PanelRect           rect = rects[i].Aligned();
+      m5epd_update_mode_t mode = clean[i] ? UPDATE_MODE_GC16 : modes[i];
+
+      M5.EPD.UpdateArea(rect.x, rect.y, rect.w, rect.h, mode);
+      counts[mode]++;
+      if (mode == UPDATE_MODE_GC16) {
+         myData.panels.partial[i] = 0;
+      } else if (myData.panels.partial[i] < 255) {
+         myData.panels.partial[i]++;
+      }
+   }
+   Serial.println("Updated areas: GC16 " + String(counts[UPDATE_MODE_GC16]) + ", GL16 " + String(counts[UPDATE_MODE_GL16]) +
+                  ", DU " + String(counts[UPDATE_MODE_DU]) + ", A2 " + String(counts[UPDATE_MODE_A2]));
+}
+
+/**
+  * Draw the parts of Show() that need no network data into the canvas: the background and the indoor panel.
+  * The displayed frame of the last wake is loaded too. setup() runs it during the fetch of the weather data,
+  * the next Show() continues with the canvas. The banded mode draws everything in Show().
+  */
+void WeatherDisplay::Prepare()
+{
+#ifndef BAND_HEIGHT
+   bool indoor[PANEL_COUNT] = {};
+
+   canvas.createCanvas(maxX, maxY);
+   SetTextSize(3);
    canvas.setTextColor(WHITE, BLACK);
    canvas.setTextDatum(TL_DATUM);
 
-   DrawHead();
+   preparedFrame = myData.panels.IsValid() ? LoadPreviousFrame() : NULL;
+   preparedHash  = GetIndoorHash();
+   LoadBackground();
+   indoor[PANEL_INDOOR] = true;
+   layers = LAYER_DYNAMIC;
+   DrawLayout(indoor);
+   layers = LAYER_ALL;
+   prepared = true;
+#endif
+}
 
-   // x = 960 y = 540
-   // 540 - oben 35 - unten 10 = 495
-   
-   // big row with current info
-   int current_box_top = 35;
-   int current_box_height = 320;
-   int xPos0 = 15;
-   int xPos1 = 232 + 15;
-   int xPos2 = 2 * 232 - 35;
-   int xPos3 = 3 * 232 - 5;
-
-   int row1width = xPos1 - xPos0;
-   int row2width = xPos2 - xPos1;
-   int row3width = xPos3 - xPos2;
-   int row4width =  maxX - xPos3;
+/**
+  * Main function to show all the data to the e-paper.
+  * Only the panels whose input hash differs from the displayed one are drawn and pushed,
+  * all panels if the e-paper content is unknown. The pushed panels are compared with the
+  * stored frame of the last wake and only their changed areas are updated.
+  */
+void WeatherDisplay::Show()
+{
+   Serial.println("WeatherDisplay::Show");
 
-   
-   DrawWeatherInfo(xPos0, current_box_top, row1width, current_box_height);
-   DrawSunInfo    (xPos1, current_box_top, row2width, current_box_height);
-   DrawWindInfo   (xPos2, current_box_top, row3width, current_box_height);
-   DrawM5PaperInfo(xPos3, current_box_top, row4width, current_box_height);
-   // current info border
-   canvas.drawRect(xPos0, current_box_top,             maxX - 30, current_box_height+35, M5EPD_Canvas::G15);
-   canvas.drawLine(xPos1, current_box_top, xPos1, current_box_height+35, M5EPD_Canvas::G15);
-   canvas.drawLine(xPos2, current_box_top, xPos2, current_box_height+35, M5EPD_Canvas::G15);
-   canvas.drawLine(xPos3, current_box_top, xPos3, current_box_height+35, M5EPD_Canvas::G15);
-
-
-   // draw daily weather forcasts
-   int daily_box_height = 175;
-   int daily_box_width = 135;
-   int daily_box_top = maxY - daily_box_height;
-   int daily_box_bottom = daily_box_top + daily_box_height;
-   
-   canvas.drawRect(15, daily_box_top, maxX - 30, daily_box_height, M5EPD_Canvas::G15);
-   for (int x = 15, i = 0; i <= 4; x += daily_box_width, i++) {
-      DrawDaily(x, daily_box_top, daily_box_width, daily_box_height, myData.weather, i);
-      canvas.drawLine(x + daily_box_width, daily_box_top, x + daily_box_width, daily_box_bottom, M5EPD_Canvas::G15);
+#ifdef BAND_HEIGHT
+   canvas.createCanvas(maxX, BAND_HEIGHT);
+   SetTextSize(3);
+   canvas.setTextColor(WHITE, BLACK);
+   canvas.setTextDatum(TL_DATUM);
+#else
+   if (!prepared) {
+      Prepare();
+   }
+#endif
+
+   const PanelRect *rects = layout.rects;
+   uint32_t hash[PANEL_COUNT];
+   bool     push[PANEL_COUNT];
+   bool     clean[PANEL_COUNT];
+   bool     draw[PANEL_COUNT];
+   bool     full = !myData.panels.IsValid();
+   int      pushed = 0;
+#ifdef BAND_HEIGHT
+   uint8_t *previous = NULL; // the bands are drawn completely
+#else
+   uint8_t *previous = preparedFrame; // displayed frame of the last wake
+#endif
+
+   GetPanelHashes(hash);
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      // panels with too many partial updates are cleaned up even without changes
+      clean[i] = !full && myData.panels.partial[i] >= WAVEFORM_MAX_PARTIAL;
+      push[i]  = full || clean[i] || hash[i] != myData.panels.hash[i];
+      pushed  += push[i];
    }
-   DrawDualGraph(713, daily_box_top, 232, daily_box_height, "Rain 7days (mm/%)", 0,  7,   0,  100, myData.weather.forecastPop, 0, 0, myData.weather.forecastMaxRain, myData.weather.forecastRain);
+   // the pushed areas are aligned to 4 pixels and include a bit of the neighbours, which have to be drawn too
+   // without the displayed frame all panels are drawn to store the complete frame
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      draw[i] = push[i] || previous == NULL;
+      for (int j = 0; j < PANEL_COUNT; j++) {
+         if (push[j] && rects[i].Intersects(rects[j].Aligned())) {
+            draw[i] = true;
+         }
+      }
+   }
+   Serial.println("Changed panels: " + String(pushed) + (full ? " (full refresh)" : ""));
 
-// some graphs disabled to gain screen space, leaving here for reference
-//   canvas.drawRect(15, 408, maxX - 30, 122, M5EPD_Canvas::G15);
-//   DrawGraph( 15, 408, 232, 122, "Temp 12h (C)", 0, 12, myData.weather.hourlyTempRange[0], myData.weather.hourlyTempRange[1], myData.weather.hourlyMaxTemp, NULL);
-//   DrawDualGraph(247, 408, 232, 122, "Rain 12h (mm/%)", 0, 12,   0,  100, myData.weather.hourlyPop, 1, 0, myData.weather.hourlyMaxRain, myData.weather.hourlyRain);
-//   canvas.drawLine(480, 408, 480, 530, M5EPD_Canvas::G15);
-//   DrawGraph(481, 408, 232, 122, "Temp 7days (C)", 0,  7, myData.weather.forecastTempRange[0], myData.weather.forecastTempRange[1], myData.weather.forecastMinTemp, myData.weather.forecastMaxTemp);
+#ifdef BAND_HEIGHT
+   m5epd_update_mode_t modes[PANEL_COUNT];
 
-   // outer border
-   canvas.drawRect( 14, 34, maxX - 28, maxY - 43, M5EPD_Canvas::G15);
+   // the bands of the pushed panels are drawn one after the other and written to the image memory of the EPD
+   std::fill(modes, modes + PANEL_COUNT, UPDATE_MODE_NONE);
+   for (originY = 0; originY < maxY; originY += BAND_HEIGHT) {
+      PanelRect band = { 0, originY, maxX, min(BAND_HEIGHT, maxY - originY) };
+      bool      touched = false;
 
-   canvas.pushCanvas(0, 0, UPDATE_MODE_GC16);
+      for (int i = 0; i < PANEL_COUNT; i++) {
+         touched = touched || (push[i] && rects[i].Aligned().Intersects(band));
+      }
+      if (!touched) {
+         continue;
+      }
+      // all panels are drawn, the parts outside of the band are clipped
+      canvas.fillCanvas(0);
+      DrawLayout(draw);
+      M5.EPD.WritePartGram4bpp(0, band.y, band.w, band.h, (const uint8_t *) canvas.frameBuffer());
+
+      // a panel is updated with GL16 if one of its bands has grays
+      for (int i = 0; i < PANEL_COUNT; i++) {
+         PanelRect part = rects[i].Aligned().Clipped(band);
+
+         if (push[i] && part.h > 0) {
+            part.y -= originY;
+            m5epd_update_mode_t mode = SelectUpdateMode((const uint8_t *) canvas.frameBuffer(), NULL, maxX / 2, part);
+
+            if (modes[i] == UPDATE_MODE_NONE || mode != UPDATE_MODE_DU) {
+               modes[i] = mode;
+            }
+         }
+      }
+   }
+   originY = 0;
+   canvas.deleteCanvas();
+
+   if (full) {
+      M5.EPD.UpdateArea(0, 0, maxX, maxY, UPDATE_MODE_GC16);
+      memset(myData.panels.partial, 0, sizeof(myData.panels.partial));
+   } else {
+      UpdatePanels(modes, push, clean, rects);
+   }
+   myData.panels.frame = 0; // no stored frame matches the display
+#else
+   bool missing[PANEL_COUNT]; // drawn panels that Prepare() has not drawn
+
+   std::copy(draw, draw + PANEL_COUNT, missing);
+   if (hash[PANEL_INDOOR] == preparedHash) {
+      missing[PANEL_INDOOR] = false;
+   } else {
+      // the indoor panel changed since Prepare(), e.g. by the time of the weather server
+      LoadBackground();
+   }
+   layers = LAYER_DYNAMIC;
+   DrawRegions(missing);
+   layers = LAYER_ALL;
+
+   if (full) {
+      canvas.pushCanvas(0, 0, UPDATE_MODE_GC16);
+      memset(myData.panels.partial, 0, sizeof(myData.panels.partial));
+   } else {
+      PushChanges(previous, push, clean, draw, rects);
+   }
+   StoreFrame(previous, push, rects);
+   prepared      = false;
+   preparedFrame = NULL;
+#endif
+   myData.panels.version = PANEL_LAYOUT_VERSION;
+   memcpy(myData.panels.hash, hash, sizeof(hash));
+   GetInfoFields(myData.panels.info); // ShowM5PaperInfo() continues with the displayed texts
    delay(1000);
 }
 
-/* Update only the M5Paper part of the global data */
-void WeatherDisplay::ShowM5PaperInfo()
+/* Hash and e-paper position of the changing texts of the M5Paper info */
+void WeatherDisplay::GetInfoFields(InfoFieldState fields[INFO_COUNT])
 {
-   Serial.println("WeatherDisplay::ShowM5PaperInfo");
+   const PanelRect &box = layout.boxes[PANEL_INDOOR];
 
-   canvas.createCanvas(245, 251);
+   for (int i = 0; i < INFO_COUNT; i++) {
+      String    text;
+      PanelRect rect = GetInfoField((InfoField) i, box.x, box.y, box.w, text);
 
-   canvas.setTextSize(3);
+      fields[i] = { PanelHash().Add(text).Get(), (int16_t) rect.x, (int16_t) rect.w };
+   }
+}
+
+/**
+  * Draw the e-paper area rect aligned to 4 pixels into a canvas of its size and push it.
+  * The canvas is the clip rectangle, only the drawing functions of the layout that reach into it draw.
+  */
+m5epd_update_mode_t WeatherDisplay::PushInfoRect(const PanelRect &rect, bool clean)
+{
+   m5epd_update_mode_t mode = UPDATE_MODE_GC16;
+   bool                all[PANEL_COUNT];
+
+   std::fill(all, all + PANEL_COUNT, true);
+   canvas.createCanvas(rect.w, rect.h);
    canvas.setTextColor(WHITE, BLACK);
-   canvas.setTextDatum(TL_DATUM);
 
-   canvas.drawRect(0, 0, 245, 251, M5EPD_Canvas::G15);
-   DrawM5PaperInfo(0, 0, 245, 251);
-   
-   canvas.pushCanvas(697, 35, UPDATE_MODE_GC16);
+   originX = rect.x;
+   originY = rect.y;
+   DrawLayout(all);
+   originX = 0;
+   originY = 0;
+
+   if (!clean) {
+      mode = SelectUpdateMode((const uint8_t *) canvas.frameBuffer(), NULL, rect.w / 2, PanelRect { 0, 0, rect.w, rect.h });
+   }
+   canvas.pushCanvas(rect.x, rect.y, mode);
+   canvas.deleteCanvas();
+   return mode;
+}
+
+/**
+  * Update only the M5Paper part of the global data.
+  * If the panel shows the texts of the last call or of Show() only the changed texts are drawn and pushed,
+  * the icons and labels stay on the e-paper. Otherwise the whole panel is drawn.
+  */
+void WeatherDisplay::ShowM5PaperInfo()
+{
+   Serial.println("WeatherDisplay::ShowM5PaperInfo");
+
+   const PanelRect &area     = layout.rects[PANEL_INDOOR]; // e-paper area of the panel
+   const PanelRect &box      = layout.boxes[PANEL_INDOOR];
+   uint8_t         &partial  = myData.panels.partial[PANEL_INDOOR];
+   bool             clean    = partial >= WAVEFORM_MAX_PARTIAL;
+   bool             full     = clean;
+   bool             fast     = false;
+   InfoFieldState   fields[INFO_COUNT];
+   PanelRect        rects[INFO_COUNT]; // changed parts of the panel
+   int              count    = 0;
+
+   for (int i = 0; i < INFO_COUNT; i++) {
+      InfoFieldState &state = myData.panels.info[i];
+      String          text;
+      PanelRect       rect  = GetInfoField((InfoField) i, box.x, box.y, box.w, text);
+
+      fields[i] = { PanelHash().Add(text).Get(), (int16_t) rect.x, (int16_t) rect.w };
+      full      = full || state.hash == 0;
+      rect      = rect.Union(PanelRect { state.x, rect.y, state.w, rect.h }).Clipped(area);
+      if (fields[i].hash != state.hash && rect.w > 0 && rect.h > 0) {
+         rects[count++] = rect.Aligned();
+      }
+   }
+   if (full) {
+      rects[0] = area.Aligned();
+      count    = 1;
+   }
+   // overlapping parts are merged, the drawing of a part includes everything inside
+   for (int i = 0; i < count; i++) {
+      for (int j = i + 1; j < count; j++) {
+         if (rects[i].Intersects(rects[j])) {
+            rects[i] = rects[i].Union(rects[j]);
+            rects[j] = rects[--count];
+            j = i;
+         }
+      }
+   }
+   for (int i = 0; i < count; i++) {
+      fast = PushInfoRect(rects[i], clean) != UPDATE_MODE_GC16 || fast;
+   }
+   if (clean) {
+      partial = 0;
+   } else if (fast) {
+      partial++;
+   }
+   memcpy(myData.panels.info, fields, sizeof(fields));
+   Serial.println("Updated info parts: " + String(count) + (full ? " (full panel)" : ""));
+   // the next Show() has to redraw the panel in its own layout
+   myData.panels.Invalidate(PANEL_INDOOR);
    delay(1000);
 }
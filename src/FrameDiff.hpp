@@ -0,0 +1,181 @@
+/**
+  * @file FrameDiff.h
+  *
+  * Changed areas between the new frame and the displayed one, compared in 4bpp words.
+  */
+#pragma once
+#include "Panels.hpp"
+#include "RasterTarget.hpp"
+
+#define FRAME_DIFF_GAP     32    //!< Changed pixels of a row closer than this belong to the same area
+#define FRAME_DIFF_ROWS    8     //!< Unchanged rows that still join two areas
+#define FRAME_UPDATE_COST  16384 //!< Pixels an extra EPD update costs, areas are merged if the union is cheaper
+#define FRAME_MAX_RECTS    16    //!< Maximum number of areas, further changes join an area or replace those of their panel
+
+/* The set of changed rectangles, x and w are multiples of 4 pixels for the partial EPD updates */
+class FrameDiff
+{
+protected:
+   PanelRect rects[FRAME_MAX_RECTS + PANEL_COUNT]; //!< Changed areas, a whole panel may replace its areas beyond FRAME_MAX_RECTS
+   int       count;                                //!< Number of areas
+   PanelRect kept[FRAME_MAX_RECTS];                //!< Areas whose displayed content stays, the changed areas do not grow into them
+   int       keptCount;                            //!< Number of kept areas
+
+public:
+   FrameDiff()
+      : count(0)
+      , keptCount(0)
+   {
+   }
+
+   int Count() const
+   {
+      return count;
+   }
+
+   const PanelRect &operator[](int i) const
+   {
+      return rects[i];
+   }
+
+   /* Area that keeps its displayed content, like a panel that is not drawn into the new frame */
+   void Keep(const PanelRect &rect)
+   {
+      if (keptCount < FRAME_MAX_RECTS) {
+         kept[keptCount++] = rect;
+      }
+   }
+
+   /* Area that is always updated, like a panel without a known old content */
+   void AddRect(const PanelRect &rect)
+   {
+      AddSpan(rect.x, rect.x + rect.w, rect.y, rect.h, 0, rect);
+   }
+
+   void Compare(const RasterTarget &current, const uint8_t *previous, const PanelRect &area);
+   void Merge();
+
+protected:
+   bool CanJoin(const PanelRect &a, const PanelRect &b) const;
+   void AddSpan(int x0, int x1, int y, int h, int first, const PanelRect &area);
+};
+
+/* Check that the union of two areas does not reach into a kept area */
+bool FrameDiff::CanJoin(const PanelRect &a, const PanelRect &b) const
+{
+   PanelRect u = a.Union(b);
+
+   for (int i = 0; i < keptCount; i++) {
+      if (u.Intersects(kept[i])) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+  * Add the changed span x0..x1 of rows y..y+h of the panel area, it extends an area from first on
+  * that ends close above. If all areas are used and none may grow by the span, the whole panel
+  * area replaces the areas inside of it.
+  */
+void FrameDiff::AddSpan(int x0, int x1, int y, int h, int first, const PanelRect &area)
+{
+   PanelRect span = { x0, y, x1 - x0, h };
+
+   for (int i = first; i < count; i++) {
+      PanelRect &rect = rects[i];
+
+      if (rect.y + rect.h + FRAME_DIFF_ROWS >= y && rect.x <= x1 + FRAME_DIFF_GAP && x0 <= rect.x + rect.w + FRAME_DIFF_GAP && CanJoin(rect, span)) {
+         rect = rect.Union(span);
+         return;
+      }
+   }
+   if (count < FRAME_MAX_RECTS) {
+      rects[count++] = span;
+      return;
+   }
+   // all areas are used, the span joins the last area that does not reach into a kept area with it
+   for (int i = count - 1; i >= 0; i--) {
+      if (CanJoin(rects[i], span)) {
+         rects[i] = rects[i].Union(span);
+         return;
+      }
+   }
+   // no area may grow by the span, the whole panel is updated like one without a known old content
+   int n = first;
+
+   for (int i = first; i < count; i++) {
+      const PanelRect &rect = rects[i];
+
+      if (rect.x < area.x || rect.y < area.y || rect.x + rect.w > area.x + area.w || rect.y + rect.h > area.y + area.h) {
+         rects[n++] = rect;
+      }
+   }
+   count          = n;
+   rects[count++] = area;
+}
+
+/**
+  * Compare the area of the new frame with the displayed frame (same layout as the target)
+  * 8 pixels at a time and add the changed spans row by row.
+  * The area must be aligned to 4 pixels.
+  */
+void FrameDiff::Compare(const RasterTarget &current, const uint8_t *previous, const PanelRect &area)
+{
+   int first = count;
+   int bytes = area.w / 2;
+
+   for (int y = area.y; y < area.y + area.h; y++) {
+      const uint8_t *a     = current.Row(y) + area.x / 2;
+      const uint8_t *b     = previous + y * current.stride + area.x / 2;
+      int            start = -1; // changed span of the row in bytes
+      int            end   = -1;
+
+      for (int i = 0; i < bytes; i += 4) {
+         bool changed = i + 4 <= bytes ? LoadWord4(a + i) != LoadWord4(b + i) : memcmp(a + i, b + i, bytes - i) != 0;
+
+         if (!changed) {
+            continue;
+         }
+         if (start >= 0 && (i - end) * 2 > FRAME_DIFF_GAP) {
+            AddSpan(area.x + start * 2, area.x + end * 2, y, 1, first, area);
+            start = -1;
+         }
+         if (start < 0) {
+            start = i;
+         }
+         end = min(i + 4, bytes);
+      }
+      if (start >= 0) {
+         AddSpan(area.x + start * 2, area.x + end * 2, y, 1, first, area);
+      }
+   }
+}
+
+/* Merge the pairs of areas whose union costs less than the separate updates and reaches into no kept area, cheapest first */
+void FrameDiff::Merge()
+{
+   for (;;) {
+      long best  = FRAME_UPDATE_COST;
+      int  bestI = -1;
+      int  bestJ = -1;
+
+      for (int i = 0; i < count; i++) {
+         for (int j = i + 1; j < count; j++) {
+            PanelRect u    = rects[i].Union(rects[j]);
+            long      cost = (long) u.w * u.h - (long) rects[i].w * rects[i].h - (long) rects[j].w * rects[j].h;
+
+            if (cost < best && CanJoin(rects[i], rects[j])) {
+               best  = cost;
+               bestI = i;
+               bestJ = j;
+            }
+         }
+      }
+      if (bestI < 0) {
+         return;
+      }
+      rects[bestI] = rects[bestI].Union(rects[bestJ]);
+      rects[bestJ] = rects[--count];
+   }
+}
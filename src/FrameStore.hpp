@@ -0,0 +1,184 @@
+/**
+  * @file FrameStore.h
+  *
+  * Compressed copy of the frame on the e-paper in the flash file system,
+  * so the next wake can compare its new frame with the displayed one.
+  * The static background layer of the display is stored the same way.
+  */
+#pragma once
+#include <LittleFS.h>
+
+#define FRAME_FILE      "/frame.bin"
+#define FRAME_TEMP_FILE "/frame.tmp"
+#define BACKGROUND_FILE "/background.bin"
+#define FRAME_MAGIC     0x314D5246 // "FRM1"
+
+/* Header of the frame file */
+struct FrameHeader
+{
+   uint32_t magic; //!< FRAME_MAGIC
+   uint32_t id;    //!< Id of the frame, also kept in the NVS
+   uint32_t size;  //!< Size of the uncompressed frame buffer in bytes
+};
+
+/**
+  * PackBits compression of the packed frame buffer bytes, the white areas shrink to 2 bytes per 128.
+  * Control byte n < 128: n + 1 literal bytes follow, n > 128: the next byte repeats 257 - n times.
+  */
+class PackBitsWriter
+{
+protected:
+   File    &file;
+   uint8_t  buffer[512]; //!< Output buffer, written in blocks
+   int      used;        //!< Bytes in the buffer
+   bool     ok;          //!< All writes succeeded
+
+public:
+   PackBitsWriter(File &file)
+      : file(file)
+      , used(0)
+      , ok(true)
+   {
+   }
+
+   bool Write(const uint8_t *data, size_t size);
+
+protected:
+   void Put(uint8_t value)
+   {
+      if (used == sizeof(buffer)) {
+         Flush();
+      }
+      buffer[used++] = value;
+   }
+
+   void Flush()
+   {
+      ok = ok && file.write(buffer, used) == (size_t) used;
+      used = 0;
+   }
+};
+
+/* Compress the data into the file */
+bool PackBitsWriter::Write(const uint8_t *data, size_t size)
+{
+   size_t i = 0;
+
+   while (i < size) {
+      size_t run = 1;
+
+      while (i + run < size && run < 128 && data[i + run] == data[i]) {
+         run++;
+      }
+      if (run >= 2) {
+         Put(257 - run);
+         Put(data[i]);
+         i += run;
+      } else {
+         size_t literal = 1;
+
+         // literals end before the next pair of equal bytes
+         while (i + literal < size && literal < 128 &&
+                !(i + literal + 1 < size && data[i + literal] == data[i + literal + 1])) {
+            literal++;
+         }
+         Put(literal - 1);
+         for (size_t j = 0; j < literal; j++) {
+            Put(data[i + j]);
+         }
+         i += literal;
+      }
+   }
+   Flush();
+   return ok;
+}
+
+/* Expand PackBits data, returns false if the data does not fill exactly size bytes */
+bool UnpackBits(const uint8_t *src, size_t length, uint8_t *data, size_t size)
+{
+   const uint8_t *end = src + length;
+   size_t         i   = 0;
+
+   while (src < end) {
+      uint8_t n = *src++;
+
+      if (n < 128) {
+         if (src + n + 1 > end || i + n + 1 > size) {
+            return false;
+         }
+         memcpy(data + i, src, n + 1);
+         src += n + 1;
+         i   += n + 1;
+      } else if (n > 128) {
+         if (src >= end || i + 257 - n > size) {
+            return false;
+         }
+         memset(data + i, *src++, 257 - n);
+         i += 257 - n;
+      }
+   }
+   return i == size;
+}
+
+/* Store the frame buffer with its id, the old frame is replaced only after the new one is complete */
+bool SaveFrame(const uint8_t *frame, size_t size, uint32_t id, const char *path = FRAME_FILE)
+{
+   FrameHeader header = { FRAME_MAGIC, id, (uint32_t) size };
+   File        file;
+   bool        ok;
+
+   if (!LittleFS.begin(true)) {
+      Serial.println("SaveFrame: no file system");
+      return false;
+   }
+   file = LittleFS.open(FRAME_TEMP_FILE, "w");
+   if (!file) {
+      Serial.println("SaveFrame: can not create " FRAME_TEMP_FILE);
+      return false;
+   }
+   PackBitsWriter writer(file);
+
+   ok = file.write((const uint8_t *) &header, sizeof(header)) == sizeof(header) && writer.Write(frame, size);
+   file.close();
+   if (ok) {
+      LittleFS.remove(path);
+      ok = LittleFS.rename(FRAME_TEMP_FILE, path);
+   } else {
+      LittleFS.remove(FRAME_TEMP_FILE);
+   }
+   if (!ok) {
+      Serial.println("SaveFrame: write of " + String(path) + " failed");
+   }
+   return ok;
+}
+
+/* Load the frame buffer of the last wake, fails if the stored frame has another id or size */
+bool LoadFrame(uint8_t *frame, size_t size, uint32_t id, const char *path = FRAME_FILE)
+{
+   FrameHeader header;
+   File        file;
+   uint8_t    *packed;
+   size_t      length;
+   bool        ok;
+
+   if (id == 0 || !LittleFS.begin(true)) {
+      return false;
+   }
+   file = LittleFS.open(path, "r");
+   if (!file || file.read((uint8_t *) &header, sizeof(header)) != sizeof(header) ||
+       header.magic != FRAME_MAGIC || header.id != id || header.size != size) {
+      Serial.println("LoadFrame: no " + String(path) + " with id " + String(id));
+      return false;
+   }
+   length = file.size() - sizeof(header);
+   packed = (uint8_t *) ps_malloc(length);
+   if (packed == NULL) {
+      return false;
+   }
+   ok = file.read(packed, length) == length && UnpackBits(packed, length, frame, size);
+   free(packed);
+   if (!ok) {
+      Serial.println("LoadFrame: damaged " + String(path));
+   }
+   return ok;
+}
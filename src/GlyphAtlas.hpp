@@ -0,0 +1,153 @@
+/**
+  * @file GlyphAtlas.h
+  *
+  * Pre-rasterized glyphs of the text sizes used by the display.
+  */
+#pragma once
+#include <M5EPD.h>
+#include "RasterTarget.hpp"
+
+#define GLYPH_FIRST ' '
+#define GLYPH_LAST  '~'
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+
+/**
+  * All printable glyphs of the GLCD font in one text size, rendered once into a 4bpp canvas.
+  * The canvas library rasterizes the glyphs on first use, so the atlas matches drawString exactly.
+  * Text is drawn opaque in WHITE on BLACK, like all text of the display.
+  */
+class GlyphAtlas
+{
+protected:
+   uint8_t       size;   //!< Text size
+   M5EPD_Canvas *glyphs; //!< All glyphs side by side, NULL until the first use
+
+public:
+   GlyphAtlas(uint8_t size)
+      : size(size)
+      , glyphs(NULL)
+   {
+   }
+
+   /* Advance of every glyph of the GLCD font */
+   int GlyphWidth() const
+   {
+      return 6 * size;
+   }
+
+   int GlyphHeight() const
+   {
+      return 8 * size;
+   }
+
+   /* Width of a text, the font has a fixed advance */
+   int TextWidth(const String &text) const
+   {
+      return text.length() * GlyphWidth();
+   }
+
+   /* Rasterize the glyphs now, the parallel rendering must not build the atlas from several threads */
+   void Prepare()
+   {
+      if (glyphs == NULL) {
+         Build();
+      }
+   }
+
+   bool Draw(const RasterTarget &target, int x, int y, const String &text);
+
+protected:
+   void Build();
+};
+
+/* Render all glyphs into the atlas canvas, which the canvas library allocates in PSRAM */
+void GlyphAtlas::Build()
+{
+   String text;
+
+   for (char c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+      text += c;
+   }
+   glyphs = new M5EPD_Canvas(&M5.EPD);
+   glyphs->createCanvas(GLYPH_COUNT * GlyphWidth(), GlyphHeight());
+   glyphs->setTextSize(size);
+   glyphs->setTextColor(WHITE, BLACK);
+   glyphs->setTextDatum(TL_DATUM);
+   glyphs->drawString(text, 0, 0, 1);
+}
+
+/**
+  * Copy the glyph rows of a text into the frame buffer of the target, rows outside of the target are skipped.
+  * Returns false if the text needs the canvas functions: text clipped at the left or right,
+  * invalid targets or characters outside of the atlas.
+  */
+bool GlyphAtlas::Draw(const RasterTarget &target, int x, int y, const String &text)
+{
+   int length = text.length();
+   int top    = max(0, -y);
+   int bottom = min(GlyphHeight(), target.height - y);
+
+   if (!target.Contains(x, y + top, length * GlyphWidth(), max(bottom - top, 0))) {
+      return false;
+   }
+   for (int i = 0; i < length; i++) {
+      if (text[i] < GLYPH_FIRST || text[i] > GLYPH_LAST) {
+         return false;
+      }
+   }
+   Prepare();
+
+   const uint8_t *atlas       = (const uint8_t *) glyphs->frameBuffer();
+   int            atlasStride = GLYPH_COUNT * GlyphWidth() / 2;
+   int            glyphStride = GlyphWidth() / 2;
+
+   for (int yi = top; yi < bottom; yi++) {
+      uint8_t       *row = target.Row(y + yi);
+      const uint8_t *src = atlas + yi * atlasStride;
+
+      for (int i = 0; i < length; i++) {
+         BlitRow4<false>(row, x + i * GlyphWidth(), src + (text[i] - GLYPH_FIRST) * glyphStride, GlyphWidth());
+      }
+   }
+   return true;
+}
+
+/* The atlases of the text sizes used by the display, other sizes use the canvas functions */
+class TextAtlas
+{
+protected:
+   GlyphAtlas size2; //!< Graph labels
+   GlyphAtlas size3; //!< Daily forecasts, compass
+   GlyphAtlas size4; //!< Headings, values
+   GlyphAtlas size7; //!< Big temperature and humidity
+
+public:
+   TextAtlas()
+      : size2(2)
+      , size3(3)
+      , size4(4)
+      , size7(7)
+   {
+   }
+
+   /* Get the atlas of a text size, NULL if there is none */
+   GlyphAtlas *Get(uint8_t size)
+   {
+      switch (size) {
+         case 2: return &size2;
+         case 3: return &size3;
+         case 4: return &size4;
+         case 7: return &size7;
+      }
+      return NULL;
+   }
+
+   /* Rasterize the glyphs of all sizes */
+   void Prepare()
+   {
+      size2.Prepare();
+      size3.Prepare();
+      size4.Prepare();
+      size7.Prepare();
+   }
+};
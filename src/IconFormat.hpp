@@ -0,0 +1,95 @@
+/**
+  * @file IconFormat.h
+  *
+  * Native packed and run length encoded 4bpp icon formats and 1 bit high contrast masks.
+  * The frame buffer kernels to draw them are in RasterTarget.hpp.
+  * The icons are converted by tools/icons.py at build time and embedded as binary blob.
+  */
+#pragma once
+#include <stdint.h>
+
+/* Storage formats of the icon data, gray values are 0 for white and 15 for black */
+enum IconFormat : uint8_t
+{
+   ICON_PACKED4, //!< Two pixels per byte with the left pixel in the high nibble, like the M5EPD_Canvas frame buffer
+   ICON_RLE4     //!< One byte per run, gray value in the high nibble and length - 1 in the low nibble, runs never cross rows
+};
+
+/* Descriptor of one icon */
+struct Icon
+{
+   uint8_t        width;  //!< Width in pixels (even)
+   uint8_t        height; //!< Height in pixels
+   IconFormat     format; //!< Storage format of the data
+   const uint8_t *data;   //!< Icon data
+   const uint8_t *mask;   //!< 1 bit high contrast mask, one bit per non white pixel, NULL if not generated
+
+   /* Bytes of one packed row */
+   constexpr int Stride() const
+   {
+      return width / 2;
+   }
+
+   /* Gray value of one pixel of a packed icon */
+   uint8_t Pixel(int x, int y) const
+   {
+      uint8_t b = data[y * Stride() + x / 2];
+
+      return (x & 1) ? (b & 0x0F) : (b >> 4);
+   }
+};
+
+/**
+  * Call f(x, length, gray) for every run of one row of a run length encoded icon.
+  * Returns the start of the next row, so an icon is streamed row by row.
+  */
+template <typename F>
+inline const uint8_t *ForEachRleRun(const uint8_t *src, int width, F f)
+{
+   for (int x = 0; x < width; src++) {
+      int length = (*src & 0x0F) + 1;
+
+      f(x, length, *src >> 4);
+      x += length;
+   }
+   return src;
+}
+
+/* Size and position of one icon in the icon blob */
+struct IconEntry
+{
+   uint8_t    width;  //!< Width in pixels
+   uint8_t    height; //!< Height in pixels
+   IconFormat format; //!< Storage format of the data
+   uint32_t   offset; //!< Start of the data in the blob
+   uint32_t   mask;   //!< Start of the high contrast mask in the blob or ICON_NO_MASK
+};
+
+#define ICON_NO_MASK 0xFFFFFFFF
+
+#include "IconIndex.hpp"
+
+/* The icon blob generated/icons.bin, embedded by the linker */
+extern const uint8_t iconBlob[] asm("_binary_generated_icons_bin_start");
+
+/* Index of the largest generated size that fits into size pixels, the smallest size if none fits */
+constexpr int IconSizeIndex(int size)
+{
+   int index = 0;
+
+   for (int i = 1; i < ICON_SIZE_COUNT; i++) {
+      if (ICON_SIZES[i] <= size) {
+         index = i;
+      }
+   }
+   return index;
+}
+
+/* Get the descriptor of one icon in the generated size that fits best into size pixels */
+inline Icon GetIcon(IconId id, int size)
+{
+   const IconEntry &entry = ICON_INDEX[id][IconSizeIndex(size)];
+
+   return Icon { entry.width, entry.height, entry.format, iconBlob + entry.offset,
+                 entry.mask != ICON_NO_MASK ? iconBlob + entry.mask : NULL };
+}
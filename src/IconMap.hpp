@@ -0,0 +1,98 @@
+/**
+  * @file IconMap.h
+  *
+  * Compile time lookup table from the openweathermap icon codes to the weather icons.
+  */
+#pragma once
+#include "IconFormat.hpp"
+
+/* Assignment of one openweathermap icon code to the displayed icon */
+struct IconCode
+{
+   char   code[4]; //!< openweathermap code like "10d"
+   IconId icon;    //!< Displayed icon
+};
+
+/* All known codes, some night codes are shown with other icons */
+static constexpr IconCode ICON_CODES[] = {
+   { "01d", ICON_ID_01D },
+   { "01n", ICON_ID_03N },
+   { "02d", ICON_ID_02D },
+   { "02n", ICON_ID_02N },
+   { "03d", ICON_ID_03D },
+   { "03n", ICON_ID_03N },
+   { "04d", ICON_ID_04D },
+   { "04n", ICON_ID_03N },
+   { "09d", ICON_ID_09D },
+   { "09n", ICON_ID_09N },
+   { "10d", ICON_ID_10D },
+   { "10n", ICON_ID_03N },
+   { "11d", ICON_ID_11D },
+   { "11n", ICON_ID_11N },
+   { "13d", ICON_ID_13D },
+   { "13n", ICON_ID_13N },
+   { "50d", ICON_ID_50D },
+   { "50n", ICON_ID_50N }
+};
+
+#define ICON_CODE_KEYS 200
+
+/**
+  * Perfect hash of a code: the two digits and the day/night letter give 0..199.
+  * Returns -1 for everything that is not formed like "10d".
+  */
+constexpr int IconCodeKey(const char *code)
+{
+   if (code[0] < '0' || code[0] > '9' || code[1] < '0' || code[1] > '9') return -1;
+   if ((code[2] != 'd' && code[2] != 'n') || code[3] != '\0')            return -1;
+
+   return ((code[0] - '0') * 10 + (code[1] - '0')) * 2 + (code[2] == 'n');
+}
+
+/* Table from the key to the icon */
+struct IconCodeTable
+{
+   uint8_t icon[ICON_CODE_KEYS];
+};
+
+/* Build the lookup table at compile time */
+constexpr IconCodeTable MakeIconCodeTable()
+{
+   IconCodeTable table {};
+
+   for (uint8_t &icon : table.icon) {
+      icon = ICON_ID_UNKNOWN;
+   }
+   for (const IconCode &entry : ICON_CODES) {
+      table.icon[IconCodeKey(entry.code)] = entry.icon;
+   }
+   return table;
+}
+
+/* Check that every code is well formed and only listed once */
+constexpr bool IconCodesValid()
+{
+   bool used[ICON_CODE_KEYS] = {};
+
+   for (const IconCode &entry : ICON_CODES) {
+      int key = IconCodeKey(entry.code);
+
+      if (key < 0 || used[key] || entry.icon >= ICON_ID_COUNT) {
+         return false;
+      }
+      used[key] = true;
+   }
+   return true;
+}
+
+static_assert(IconCodesValid(), "invalid or duplicate entry in ICON_CODES");
+
+static constexpr IconCodeTable ICON_CODE_TABLE = MakeIconCodeTable();
+
+/* Get the icon id of an openweathermap icon code, unknown codes get the unknown icon */
+inline IconId GetWeatherIcon(const char *code)
+{
+   int key = code != NULL ? IconCodeKey(code) : -1;
+
+   return key < 0 ? ICON_ID_UNKNOWN : (IconId) ICON_CODE_TABLE.icon[key];
+}
@@ -0,0 +1,91 @@
+/**
+  * @file JsonPeakAllocator.h
+  *
+  * ArduinoJson allocator measuring the peak heap usage of a JsonDocument.
+  */
+#pragma once
+#include <ArduinoJson.h>
+#include <stddef.h>
+
+/**
+  * Allocates from the heap like the default allocator of ArduinoJson and counts the allocated bytes.
+  * deallocate() gets no size, so every block starts with a header keeping its size.
+  */
+class JsonPeakAllocator : public ArduinoJson::Allocator
+{
+protected:
+   struct alignas(std::max_align_t) Header
+   {
+      size_t size; //!< Size requested by the document
+   };
+
+   size_t current; //!< Bytes allocated now
+   size_t peak;    //!< Most bytes allocated at the same time
+   int    count;   //!< Number of allocations
+
+public:
+   JsonPeakAllocator()
+      : current(0)
+      , peak(0)
+      , count(0)
+   {
+   }
+
+   size_t Peak() const
+   {
+      return peak;
+   }
+
+   int Count() const
+   {
+      return count;
+   }
+
+   void *allocate(size_t size) override
+   {
+      Header *block = (Header *) malloc(sizeof(Header) + size);
+
+      if (block == NULL) {
+         return NULL;
+      }
+      block->size = size;
+      Add(size);
+      return block + 1;
+   }
+
+   void deallocate(void *pointer) override
+   {
+      if (pointer != NULL) {
+         Header *block = (Header *) pointer - 1;
+
+         current -= block->size;
+         free(block);
+      }
+   }
+
+   void *reallocate(void *pointer, size_t size) override
+   {
+      if (pointer == NULL) {
+         return allocate(size);
+      }
+      Header *block = (Header *) pointer - 1;
+      size_t  old   = block->size;
+      Header *moved = (Header *) realloc(block, sizeof(Header) + size);
+
+      if (moved == NULL) {
+         return NULL;
+      }
+      moved->size = size;
+      current    -= old;
+      Add(size);
+      return moved + 1;
+   }
+
+protected:
+   void Add(size_t size)
+   {
+      current += size;
+      peak     = max(peak, current);
+      count++;
+   }
+};
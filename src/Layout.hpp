@@ -0,0 +1,184 @@
+/**
+  * @file Layout.h
+  *
+  * Positions of the panels and borders of the display, computed at compile time from the
+  * e-paper size. Show(), ShowM5PaperInfo() and the rendering of regions share this layout.
+  */
+#pragma once
+#include "Panels.hpp"
+
+#define LAYOUT_MARGIN       15  //!< Left and right distance of the panels from the e-paper border
+#define LAYOUT_CURRENT_TOP  35  //!< Top of the row with the current weather
+#define LAYOUT_CURRENT_BOX  320 //!< Height of the content of the current weather panels
+#define LAYOUT_DAILY_WIDTH  135 //!< Width of a daily forecast
+#define LAYOUT_DAILY_HEIGHT 175 //!< Height of the row with the daily forecasts and the graph
+#define LAYOUT_GRAPH_WIDTH  232 //!< Width of the rain graph
+#define LAYOUT_BOTTOM       9   //!< Distance of the outer border from the bottom of the e-paper
+#define LAYOUT_DAILY_COUNT  (PANEL_DAILY4 - PANEL_DAILY0 + 1)
+#define LAYOUT_ITEMS        22  //!< Panels and borders of the layout
+#define LAYOUT_REGIONS      10  //!< Independently rendered areas of the e-paper
+
+/* Widths of the current weather panels, the indoor panel gets the rest of the row */
+constexpr int layoutColumns[] = { 232, 182, 262 };
+
+/* One step of the drawing of the layout, the steps are drawn in order because some of them overlap */
+struct LayoutItem
+{
+   PanelId   panel; //!< Drawn panel, PANEL_COUNT for a border
+   PanelRect rect;  //!< Outline of a border, lines are 1 pixel wide outlines
+};
+
+/* Panels and borders of the display */
+struct DisplayLayout
+{
+   int        width;               //!< Width of the e-paper
+   int        height;              //!< Height of the e-paper
+   PanelRect  rects[PANEL_COUNT];  //!< Updated areas of the panels from border to border
+   PanelRect  boxes[PANEL_COUNT];  //!< Areas the panels lay out their content in
+   LayoutItem items[LAYOUT_ITEMS]; //!< Drawing order of the panels and borders
+   int        count;               //!< Used items
+   PanelRect  regions[LAYOUT_REGIONS]; //!< Areas of the parallel rendering, together they cover the e-paper once
+   int        regionCount;             //!< Used regions
+
+   constexpr void AddPanel(PanelId panel, const PanelRect &rect, const PanelRect &box)
+   {
+      rects[panel]   = rect;
+      boxes[panel]   = box;
+      items[count++] = { panel, rect };
+   }
+
+   constexpr void AddBorder(const PanelRect &outline)
+   {
+      items[count++] = { PANEL_COUNT, outline };
+   }
+
+   /* Add the regions of a row of the e-paper between the given columns, the columns are rounded down to whole bytes */
+   constexpr void AddRegions(int y, int h, const int columns[], int columnCount)
+   {
+      int left = 0;
+
+      for (int i = 0; i <= columnCount; i++) {
+         int right = i < columnCount ? columns[i] & ~1 : width;
+
+         regions[regionCount++] = { left, y, right - left, h };
+         left = right;
+      }
+   }
+};
+
+/* Layout of an e-paper of maxX x maxY pixels */
+constexpr DisplayLayout MakeLayout(int maxX, int maxY)
+{
+   DisplayLayout layout = {};
+   int           right  = maxX - LAYOUT_MARGIN;
+   int           xPos[] = { LAYOUT_MARGIN, 0, 0, 0 };
+   int           top    = LAYOUT_CURRENT_TOP;
+   int           bottom = maxY - LAYOUT_DAILY_HEIGHT; // top of the daily row
+   int           height = bottom - top;
+
+   for (int i = 1; i < 4; i++) {
+      xPos[i] = xPos[i - 1] + layoutColumns[i - 1];
+   }
+   layout.width  = maxX;
+   layout.height = maxY;
+   layout.AddPanel(PANEL_HEAD, { LAYOUT_MARGIN + 1, 0, maxX - 2 * (LAYOUT_MARGIN + 1), top - 1 }, { 0, 0, maxX, top });
+
+   // the current weather row, neighbouring panels share their border line
+   for (int i = 0; i < 4; i++) {
+      int next = i < 3 ? xPos[i + 1] : right;
+
+      layout.AddPanel((PanelId) (PANEL_WEATHER + i), { xPos[i], top, next - xPos[i] + (i < 3), height },
+                      { xPos[i], top, i < 3 ? next - xPos[i] : maxX - xPos[i], LAYOUT_CURRENT_BOX });
+   }
+   layout.AddBorder({ LAYOUT_MARGIN, top, right - LAYOUT_MARGIN, height + 1 });
+   for (int i = 1; i < 4; i++) {
+      layout.AddBorder({ xPos[i], top, 1, height + 1 });
+   }
+
+   // the daily row with the forecasts and the rain graph in the rest of the row
+   layout.AddBorder({ LAYOUT_MARGIN, bottom, right - LAYOUT_MARGIN, LAYOUT_DAILY_HEIGHT });
+   for (int i = 0; i < LAYOUT_DAILY_COUNT; i++) {
+      int x = LAYOUT_MARGIN + i * LAYOUT_DAILY_WIDTH;
+
+      layout.AddPanel((PanelId) (PANEL_DAILY0 + i), { x, bottom, LAYOUT_DAILY_WIDTH + 1, LAYOUT_DAILY_HEIGHT },
+                      { x, bottom, LAYOUT_DAILY_WIDTH, LAYOUT_DAILY_HEIGHT });
+      layout.AddBorder({ x + LAYOUT_DAILY_WIDTH, bottom, 1, LAYOUT_DAILY_HEIGHT });
+   }
+   int graphX = LAYOUT_MARGIN + LAYOUT_DAILY_COUNT * LAYOUT_DAILY_WIDTH;
+
+   layout.AddPanel(PANEL_GRAPH, { graphX, bottom, right - graphX, LAYOUT_DAILY_HEIGHT },
+                   { right - LAYOUT_GRAPH_WIDTH, bottom, LAYOUT_GRAPH_WIDTH, LAYOUT_DAILY_HEIGHT });
+
+   // outer border
+   layout.AddBorder({ LAYOUT_MARGIN - 1, top - 1, maxX - 2 * (LAYOUT_MARGIN - 1), maxY - LAYOUT_BOTTOM - (top - 1) });
+
+   // one region for every column of the current weather with its part of the head and one for every daily box and the graph
+   int dailyColumns[LAYOUT_DAILY_COUNT] = {};
+
+   for (int i = 0; i < LAYOUT_DAILY_COUNT; i++) {
+      dailyColumns[i] = LAYOUT_MARGIN + (i + 1) * LAYOUT_DAILY_WIDTH;
+   }
+   layout.AddRegions(0, bottom, xPos + 1, 3);
+   layout.AddRegions(bottom, maxY - bottom, dailyColumns, LAYOUT_DAILY_COUNT);
+   return layout;
+}
+
+/* Check that a rectangle is not empty and lies on the e-paper */
+constexpr bool IsOnLayout(const DisplayLayout &layout, const PanelRect &rect)
+{
+   return rect.w > 0 && rect.h > 0 && rect.x >= 0 && rect.y >= 0 && rect.x + rect.w <= layout.width && rect.y + rect.h <= layout.height;
+}
+
+/* Check that all items are used, all areas lie on the e-paper and the panels share at most their border lines */
+constexpr bool IsValidLayout(const DisplayLayout &layout)
+{
+   int area = 0;
+
+   if (layout.count != LAYOUT_ITEMS || layout.regionCount != LAYOUT_REGIONS) {
+      return false;
+   }
+   // the regions start at whole bytes and cover the e-paper without overlaps
+   for (int i = 0; i < LAYOUT_REGIONS; i++) {
+      const PanelRect &a = layout.regions[i];
+
+      if (!IsOnLayout(layout, a) || (a.x & 1) != 0 || (a.w & 1) != 0) {
+         return false;
+      }
+      for (int j = i + 1; j < LAYOUT_REGIONS; j++) {
+         const PanelRect &b = layout.regions[j];
+
+         if (a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h) {
+            return false;
+         }
+      }
+      area += a.w * a.h;
+   }
+   if (area != layout.width * layout.height) {
+      return false;
+   }
+   for (int i = 0; i < LAYOUT_ITEMS; i++) {
+      if (!IsOnLayout(layout, layout.items[i].rect)) {
+         return false;
+      }
+   }
+   for (int i = 0; i < PANEL_COUNT; i++) {
+      const PanelRect &a = layout.rects[i];
+
+      if (!IsOnLayout(layout, a) || !IsOnLayout(layout, layout.boxes[i])) {
+         return false;
+      }
+      for (int j = i + 1; j < PANEL_COUNT; j++) {
+         const PanelRect &b = layout.rects[j];
+
+         if (a.x + 1 < b.x + b.w && b.x + 1 < a.x + a.w && a.y + 1 < b.y + b.h && b.y + 1 < a.y + a.h) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+/* Layout of the M5Paper, WeatherDisplay only draws with this checked layout */
+constexpr DisplayLayout layout960x540 = MakeLayout(960, 540);
+
+static_assert(IsValidLayout(layout960x540), "panels overlap or leave the e-paper");
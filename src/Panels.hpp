@@ -0,0 +1,158 @@
+/**
+  * @file Panels.h
+  *
+  * The panels of the display layout and the hashes of their inputs,
+  * used to redraw only the panels whose data has changed since the last refresh.
+  */
+#pragma once
+#include <Arduino.h>
+#include <type_traits>
+
+// Increment on every layout change, stored panels of other versions are redrawn completely.
+#define PANEL_LAYOUT_VERSION 2
+
+/* All panels of Show() */
+enum PanelId : uint8_t
+{
+   PANEL_HEAD,    //!< Version, city, rssi and battery
+   PANEL_WEATHER, //!< Current weather
+   PANEL_SUN,     //!< Sunrise and sunset
+   PANEL_WIND,    //!< Wind compass
+   PANEL_INDOOR,  //!< M5Paper sensor data and RTC
+   PANEL_DAILY0,  //!< Daily forecasts, today first
+   PANEL_DAILY1,
+   PANEL_DAILY2,
+   PANEL_DAILY3,
+   PANEL_DAILY4,
+   PANEL_GRAPH,   //!< Rain graph of the daily forecasts
+   PANEL_COUNT
+};
+
+/* Texts of the indoor panel of ShowM5PaperInfo() that are updated on their own */
+enum InfoField : uint8_t
+{
+   INFO_DATE,        //!< RTC date
+   INFO_TIME,        //!< RTC time
+   INFO_TEMPERATURE, //!< SHT30 temperature
+   INFO_HUMIDITY,    //!< SHT30 humidity
+   INFO_COUNT
+};
+
+/* Screen area of a panel */
+struct PanelRect
+{
+   int x; //!< Left
+   int y; //!< Top
+   int w; //!< Width
+   int h; //!< Height
+
+   /* Rectangle with x and w extended to multiples of 4 pixels, the unit of the partial EPD updates */
+   PanelRect Aligned() const
+   {
+      int left  = x & ~3;
+      int right = (x + w + 3) & ~3;
+
+      return PanelRect { left, y, right - left, h };
+   }
+
+   bool Intersects(const PanelRect &other) const
+   {
+      return x < other.x + other.w && other.x < x + w && y < other.y + other.h && other.y < y + h;
+   }
+
+   /* Smallest rectangle containing both */
+   PanelRect Union(const PanelRect &other) const
+   {
+      int x0 = min(x, other.x);
+      int y0 = min(y, other.y);
+      int x1 = max(x + w, other.x + other.w);
+      int y1 = max(y + h, other.y + other.h);
+
+      return PanelRect { x0, y0, x1 - x0, y1 - y0 };
+   }
+
+   /* Part inside of the other rectangle, empty if they do not intersect */
+   PanelRect Clipped(const PanelRect &other) const
+   {
+      int x0 = max(x, other.x);
+      int y0 = max(y, other.y);
+      int x1 = min(x + w, other.x + other.w);
+      int y1 = min(y + h, other.y + other.h);
+
+      return PanelRect { x0, y0, max(x1 - x0, 0), max(y1 - y0, 0) };
+   }
+};
+
+/* FNV-1a hash of the inputs of one panel */
+class PanelHash
+{
+protected:
+   uint32_t value; //!< Hash of all added values
+
+public:
+   PanelHash()
+      : value(2166136261u)
+   {
+   }
+
+   PanelHash &Add(const void *data, size_t length)
+   {
+      const uint8_t *bytes = (const uint8_t *) data;
+
+      for (size_t i = 0; i < length; i++) {
+         value = (value ^ bytes[i]) * 16777619u;
+      }
+      return *this;
+   }
+
+   /* Only numbers, so the char arrays of the texts take the const char * overload */
+   template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+   PanelHash &Add(T number)
+   {
+      return Add(&number, sizeof(number));
+   }
+
+   PanelHash &Add(const char *text)
+   {
+      return Add(text, strlen(text) + 1);
+   }
+
+   PanelHash &Add(const String &text)
+   {
+      return Add(text.c_str(), text.length() + 1);
+   }
+
+   /* Hash value, never 0 which marks a panel that has to be redrawn */
+   uint32_t Get() const
+   {
+      return value != 0 ? value : 1;
+   }
+};
+
+/* Displayed text of the indoor panel for ShowM5PaperInfo() */
+struct InfoFieldState
+{
+   uint32_t hash; //!< Hash of the text, 0 if unknown
+   int16_t  x;    //!< Left of the text on the e-paper
+   int16_t  w;    //!< Width of the text
+};
+
+/* Hashes of the displayed panels, kept in the NVS across shutdowns */
+struct PanelState
+{
+   uint32_t       version;              //!< PANEL_LAYOUT_VERSION of the displayed layout, 0 if unknown
+   uint32_t       hash[PANEL_COUNT];    //!< Input hash of every displayed panel, 0 if it has to be redrawn
+   uint32_t       frame;                //!< Id of the stored copy of the displayed frame, 0 if there is none
+   uint8_t        partial[PANEL_COUNT]; //!< DU, A2 and GL16 updates of every panel since its last GC16 update
+   InfoFieldState info[INFO_COUNT];     //!< Displayed texts of the indoor panel
+
+   bool IsValid() const
+   {
+      return version == PANEL_LAYOUT_VERSION;
+   }
+
+   void Invalidate(PanelId panel)
+   {
+      hash[panel] = 0;
+   }
+};
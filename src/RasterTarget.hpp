@@ -0,0 +1,323 @@
+/**
+  * @file RasterTarget.h
+  *
+  * Direct drawing into a packed 4bpp frame buffer with SWAR span kernels.
+  * The frame buffer can be the one of a M5EPD_Canvas or any buffer in memory.
+  */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// The host build counts the kernel calls for the render benchmarks.
+#ifndef RASTER_STAT
+#define RASTER_STAT(counter)
+#endif
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the word kernels assume little endian words");
+
+/* 32 bit word that may alias the frame buffer bytes */
+typedef uint32_t __attribute__((may_alias)) Word4;
+
+/* Load 4 frame buffer bytes of any alignment as word in memory order */
+inline uint32_t LoadWord4(const uint8_t *src)
+{
+   uint32_t value;
+
+   memcpy(&value, src, sizeof(value));
+   return value;
+}
+
+/* Store a word in memory order into 4 frame buffer bytes of any alignment */
+inline void StoreWord4(uint8_t *dst, uint32_t value)
+{
+   memcpy(dst, &value, sizeof(value));
+}
+
+/* Map every non white pixel of a packed byte to black */
+constexpr uint8_t ContrastByte4(uint8_t b)
+{
+   return ((b & 0xF0) ? 0xF0 : 0x00) | ((b & 0x0F) ? 0x0F : 0x00);
+}
+
+/* Write the masked nibbles of one packed byte, or set them to black in high contrast mode */
+template <bool highContrast>
+inline void PutByte4(uint8_t &dst, uint8_t src, uint8_t mask)
+{
+   if (highContrast) {
+      dst |= ContrastByte4(src) & mask;
+   } else {
+      dst = (dst & ~mask) | (src & mask);
+   }
+}
+
+/**
+  * Copy one packed row into a packed frame buffer row.
+  * Even x positions are copied bytewise, odd x positions are shifted by one nibble
+  * on the fly, 8 pixels per 32 bit word.
+  */
+template <bool highContrast>
+inline void BlitRow4(uint8_t *row, int x, const uint8_t *src, int width)
+{
+   uint8_t *dst    = row + x / 2;
+   int      stride = width / 2;
+
+   RASTER_STAT(rasterRows);
+   if ((x & 1) == 0) {
+      if (!highContrast) {
+         memcpy(dst, src, stride);
+      } else {
+         for (int i = 0; i < stride; i++) {
+            PutByte4<true>(dst[i], src[i], 0xFF);
+         }
+      }
+   } else {
+      int i = 1;
+
+      PutByte4<highContrast>(dst[0], src[0] >> 4, 0x0F);
+      if (!highContrast) {
+         // byte i is the low nibble of source byte i - 1 and the high nibble of byte i
+         for (; i + 4 <= stride; i += 4) {
+            uint32_t word = __builtin_bswap32(LoadWord4(src + i - 1));
+
+            StoreWord4(dst + i, __builtin_bswap32((word << 4) | (src[i + 3] >> 4)));
+         }
+      }
+      for (; i < stride; i++) {
+         uint8_t b = (src[i - 1] << 4) | (src[i] >> 4);
+
+         if (highContrast) {
+            dst[i] |= ContrastByte4(b);
+         } else {
+            dst[i] = b;
+         }
+      }
+      PutByte4<highContrast>(dst[stride], src[stride - 1] << 4, 0xF0);
+   }
+}
+
+/* Fill a span of pixels of a packed frame buffer row, the inner part with aligned 32 bit words */
+inline void FillSpan4(uint8_t *row, int x, int length, uint8_t gray)
+{
+   uint8_t *dst  = row + x / 2;
+   uint32_t word = gray * 0x11111111u;
+   int      bytes;
+
+   if (length <= 0) {
+      return;
+   }
+   RASTER_STAT(rasterSpans);
+   if (x & 1) {
+      *dst = (*dst & 0xF0) | gray;
+      dst++;
+      length--;
+   }
+   bytes = length / 2;
+   for (; bytes > 0 && ((uintptr_t) dst & 3) != 0; bytes--) {
+      *dst++ = (uint8_t) word;
+   }
+   for (; bytes >= 4; bytes -= 4, dst += 4) {
+      *(Word4 *) dst = word;
+   }
+   for (; bytes > 0; bytes--) {
+      *dst++ = (uint8_t) word;
+   }
+   if (length & 1) {
+      *dst = (*dst & 0x0F) | gray << 4;
+   }
+}
+
+/* Expand 8 mask bits to 8 black pixels, as the word of the four packed frame buffer bytes in memory order */
+constexpr uint32_t ExpandMask4(uint8_t bits)
+{
+   uint32_t word = 0;
+
+   for (int i = 0; i < 8; i++) {
+      if (bits & (0x80 >> i)) {
+         word |= (uint32_t) 0x0F << ((i / 2) * 8 + ((i & 1) ? 0 : 4));
+      }
+   }
+   return word;
+}
+
+/* Expanded words of all 256 mask bytes */
+struct MaskExpandTable
+{
+   uint32_t word[256];
+};
+
+constexpr MaskExpandTable MakeMaskExpandTable()
+{
+   MaskExpandTable table {};
+
+   for (int i = 0; i < 256; i++) {
+      table.word[i] = ExpandMask4((uint8_t) i);
+   }
+   return table;
+}
+
+static constexpr MaskExpandTable MASK_EXPAND_TABLE = MakeMaskExpandTable();
+
+/* Set the black pixels of an expanded mask word in 4 frame buffer bytes of any alignment */
+inline void OrWord4(uint8_t *dst, uint32_t word)
+{
+   StoreWord4(dst, LoadWord4(dst) | word);
+}
+
+/**
+  * Set the pixels of one 1 bit mask row to black in a packed frame buffer row.
+  * 8 pixels are written with one word operation, white mask bytes are skipped.
+  * The width must be a multiple of 8.
+  */
+inline void BlitMaskRow4(uint8_t *row, int x, const uint8_t *mask, int width)
+{
+   uint8_t *dst = row + x / 2;
+
+   RASTER_STAT(rasterMaskRows);
+   for (int i = 0; i < width / 8; i++, dst += 4) {
+      uint8_t bits = mask[i];
+
+      if (bits == 0) {
+         continue;
+      }
+      if ((x & 1) == 0) {
+         OrWord4(dst, MASK_EXPAND_TABLE.word[bits]);
+      } else {
+         // first pixel into the low nibble, the other 7 shifted into the next 4 bytes
+         if (bits & 0x80) {
+            dst[0] |= 0x0F;
+         }
+         OrWord4(dst + 1, MASK_EXPAND_TABLE.word[(uint8_t) (bits << 1)]);
+      }
+   }
+}
+
+/**
+  * A packed 4bpp frame buffer: two pixels per byte with the left pixel in the high nibble,
+  * gray values 0 for white and 15 for black, rows of width / 2 bytes.
+  * Only even widths are supported, other buffers give an invalid target.
+  */
+class RasterTarget
+{
+public:
+   uint8_t *buffer; //!< Frame buffer, NULL for an invalid target
+   int      width;  //!< Width in pixels
+   int      height; //!< Height in pixels
+   int      stride; //!< Bytes per row
+
+public:
+   RasterTarget()
+      : buffer(NULL)
+      , width(0)
+      , height(0)
+      , stride(0)
+   {
+   }
+
+   RasterTarget(uint8_t *buffer, int width, int height)
+      : buffer((width & 1) == 0 ? buffer : NULL)
+      , width(width)
+      , height(height)
+      , stride(width / 2)
+   {
+   }
+
+   bool IsValid() const
+   {
+      return buffer != NULL;
+   }
+
+   /* Check if a rectangle lies completely inside of the frame buffer */
+   bool Contains(int x, int y, int w, int h) const
+   {
+      return buffer != NULL && x >= 0 && y >= 0 && x + w <= width && y + h <= height;
+   }
+
+   uint8_t *Row(int y) const
+   {
+      return buffer + y * stride;
+   }
+
+   /* Gray value of one pixel */
+   uint8_t Pixel(int x, int y) const
+   {
+      uint8_t b = Row(y)[x / 2];
+
+      return (x & 1) ? (b & 0x0F) : (b >> 4);
+   }
+
+   void HLine(int x, int y, int length, uint8_t gray);
+   void VLine(int x, int y, int length, uint8_t gray);
+   void FillRect(int x, int y, int w, int h, uint8_t gray);
+   void DrawRect(int x, int y, int w, int h, uint8_t gray);
+   void Blit4(int x, int y, const uint8_t *src, int w, int h);
+
+protected:
+   bool Clip(int &x, int &y, int &w, int &h) const;
+};
+
+/* Clip a rectangle to the frame buffer, returns false if nothing is left */
+bool RasterTarget::Clip(int &x, int &y, int &w, int &h) const
+{
+   if (x < 0) { w += x; x = 0; }
+   if (y < 0) { h += y; y = 0; }
+   if (x + w > width)  w = width  - x;
+   if (y + h > height) h = height - y;
+   return buffer != NULL && w > 0 && h > 0;
+}
+
+/* Draw a horizontal line of length pixels */
+void RasterTarget::HLine(int x, int y, int length, uint8_t gray)
+{
+   int h = 1;
+
+   if (Clip(x, y, length, h)) {
+      FillSpan4(Row(y), x, length, gray);
+   }
+}
+
+/* Draw a vertical line of length pixels, one nibble per row */
+void RasterTarget::VLine(int x, int y, int length, uint8_t gray)
+{
+   int w = 1;
+
+   if (Clip(x, y, w, length)) {
+      uint8_t  mask  = (x & 1) ? 0xF0 : 0x0F;
+      uint8_t  value = (x & 1) ? gray : gray << 4;
+      uint8_t *dst   = Row(y) + x / 2;
+
+      RASTER_STAT(rasterVLines);
+      for (; length > 0; length--, dst += stride) {
+         *dst = (*dst & mask) | value;
+      }
+   }
+}
+
+/* Fill a rectangle */
+void RasterTarget::FillRect(int x, int y, int w, int h, uint8_t gray)
+{
+   if (Clip(x, y, w, h)) {
+      for (uint8_t *row = Row(y); h > 0; h--, row += stride) {
+         FillSpan4(row, x, w, gray);
+      }
+   }
+}
+
+/* Draw the outline of a rectangle */
+void RasterTarget::DrawRect(int x, int y, int w, int h, uint8_t gray)
+{
+   if (w <= 0 || h <= 0) {
+      return;
+   }
+   HLine(x, y,         w, gray);
+   HLine(x, y + h - 1, w, gray);
+   VLine(x,         y, h, gray);
+   VLine(x + w - 1, y, h, gray);
+}
+
+/* Copy a packed 4bpp block of w x h pixels (w even), the block must lie inside of the frame buffer */
+void RasterTarget::Blit4(int x, int y, const uint8_t *src, int w, int h)
+{
+   for (uint8_t *row = Row(y); h > 0; h--, row += stride, src += w / 2) {
+      BlitRow4<false>(row, x, src, w);
+   }
+}
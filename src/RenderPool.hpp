@@ -0,0 +1,65 @@
+/**
+  * @file RenderPool.h
+  *
+  * Small task pool for the parallel rendering of the display regions and the drawing during the fetch.
+  * std::thread runs on pthreads on the workstation and on FreeRTOS tasks on the ESP32,
+  * so the host build checks the same code with ThreadSanitizer.
+  */
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifdef ESP_PLATFORM
+#include <esp_pthread.h>
+#endif
+
+#define RENDER_STACK_SIZE 8192 //!< Stack of a worker task, the default pthread stack of the ESP32 is too small for the drawing
+
+/* Start a thread on the core offset cores after the one of the calling task, with the stack size of the drawing */
+template <typename Work>
+std::thread StartWorker(int offset, const Work &work)
+{
+#ifdef ESP_PLATFORM
+   esp_pthread_cfg_t config  = esp_pthread_get_default_config();
+   esp_pthread_cfg_t restore = config;
+
+   config.stack_size  = RENDER_STACK_SIZE;
+   config.pin_to_core = (xPortGetCoreID() + offset) % portNUM_PROCESSORS;
+   esp_pthread_set_cfg(&config);
+
+   std::thread thread(work);
+
+   esp_pthread_set_cfg(&restore);
+   return thread;
+#else
+   (void) offset; // the host threads are not pinned
+   return std::thread(work);
+#endif
+}
+
+/**
+  * Run task(0) .. task(count - 1) on workers threads, the calling thread is one of them.
+  * A worker takes the next open task when it is done with its last one, so a worker with cheap
+  * tasks takes over the tasks the other worker did not start yet. Returns after all tasks are done.
+  */
+template <typename Task>
+void RunParallel(int count, int workers, const Task &task)
+{
+   std::atomic<int>         next(0);
+   std::vector<std::thread> threads;
+   auto                     work = [&]() {
+      for (int i = next++; i < count; i = next++) {
+         task(i);
+      }
+   };
+
+   // the workers run on the other cores than the calling task
+   for (int i = 1; i < min(workers, count); i++) {
+      threads.push_back(StartWorker(i, work));
+   }
+   work();
+   for (std::thread &thread : threads) {
+      thread.join();
+   }
+}
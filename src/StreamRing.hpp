@@ -0,0 +1,169 @@
+/**
+  * @file StreamRing.h
+  *
+  * Single producer, single consumer ring buffer between the task reading the http response
+  * and the task parsing it.
+  */
+#pragma once
+#include <atomic>
+#include <thread>
+
+#define STREAM_RING_SIZE    4096  //!< Size of the ring buffer, a power of 2
+#define STREAM_RING_TIMEOUT 5000  //!< Time in ms without data until the reading gives up
+
+static_assert((STREAM_RING_SIZE & (STREAM_RING_SIZE - 1)) == 0, "STREAM_RING_SIZE is not a power of 2");
+
+/**
+  * The producer copies the received bytes from the network stream into the ring, the consumer is
+  * a reader for deserializeJson. head and tail count the written and the read bytes, only the
+  * producer writes head and only the consumer writes tail, the buffer is allocated on the heap
+  * to keep it off the small stack of the loop task.
+  */
+class StreamRing
+{
+protected:
+   uint8_t            *buffer;    //!< Ring of STREAM_RING_SIZE bytes, NULL if the allocation failed
+   std::atomic<size_t> head;      //!< Bytes written by the producer
+   std::atomic<size_t> tail;      //!< Bytes released by the consumer
+   std::atomic<bool>   finished;  //!< The producer has written the last byte
+   std::atomic<bool>   cancelled; //!< The consumer needs no more bytes
+   size_t              readPos;   //!< Bytes read by the consumer, released in blocks
+   size_t              readEnd;   //!< head seen by the consumer
+
+public:
+   StreamRing()
+      : buffer((uint8_t *) malloc(STREAM_RING_SIZE))
+      , head(0)
+      , tail(0)
+      , finished(false)
+      , cancelled(false)
+      , readPos(0)
+      , readEnd(0)
+   {
+   }
+
+   ~StreamRing()
+   {
+      free(buffer);
+   }
+
+   bool IsValid() const
+   {
+      return buffer != NULL;
+   }
+
+   template <typename Source>
+   void Fill(Source &source, int size);
+
+   int    read();
+   size_t readBytes(char *out, size_t length);
+
+   /* The consumer needs no more bytes, stops the producer */
+   void Close()
+   {
+      cancelled.store(true, std::memory_order_release);
+   }
+
+protected:
+   bool WaitData();
+};
+
+/* Wait for the other task, the host build has no ticks to wait for */
+inline void StreamWait()
+{
+#ifdef ESP_PLATFORM
+   delay(1);
+#else
+   std::this_thread::yield();
+#endif
+}
+
+/**
+  * Producer: copy the received bytes of the source into the ring until size bytes are read
+  * (size < 0 reads until the source is closed), the source disconnects, nothing arrives for
+  * STREAM_RING_TIMEOUT or the consumer is closed. Only the bytes already received are read,
+  * so the producer never blocks in the network stack while the ring has space.
+  */
+template <typename Source>
+void StreamRing::Fill(Source &source, int size)
+{
+   size_t        total = 0;
+   unsigned long last  = millis();
+
+   while (!cancelled.load(std::memory_order_acquire) && (size < 0 || total < (size_t) size)) {
+      size_t h      = head.load(std::memory_order_relaxed);
+      size_t space  = STREAM_RING_SIZE - (h - tail.load(std::memory_order_acquire));
+      size_t offset = h & (STREAM_RING_SIZE - 1);
+      size_t length = min(space, STREAM_RING_SIZE - offset);
+      int    count  = 0;
+
+      if (size >= 0) {
+         length = min(length, size - total);
+      }
+      if (length == 0) {
+         // the ring is full, the consumer is behind
+         StreamWait();
+         last = millis();
+         continue;
+      }
+      if (source.available() > 0) {
+         count = source.read(buffer + offset, min(length, (size_t) source.available()));
+      }
+      if (count > 0) {
+         head.store(h + count, std::memory_order_release);
+         total += count;
+         last   = millis();
+      } else if (!source.connected()) {
+         break;
+      } else if (millis() - last > STREAM_RING_TIMEOUT) {
+         Serial.println("StreamRing: timeout");
+         break;
+      } else {
+         StreamWait();
+      }
+   }
+   finished.store(true, std::memory_order_release);
+}
+
+/* Consumer: release the read bytes to the producer and wait for new ones, false at the end */
+bool StreamRing::WaitData()
+{
+   tail.store(readPos, std::memory_order_release);
+   while (true) {
+      readEnd = head.load(std::memory_order_acquire);
+      if (readEnd != readPos) {
+         return true;
+      }
+      if (finished.load(std::memory_order_acquire)) {
+         // the producer may have written its last bytes before the flag
+         readEnd = head.load(std::memory_order_acquire);
+         return readEnd != readPos;
+      }
+      StreamWait();
+   }
+}
+
+/* Read one byte like Stream::read(), -1 at the end */
+int StreamRing::read()
+{
+   if (readPos == readEnd && !WaitData()) {
+      return -1;
+   }
+   return buffer[readPos++ & (STREAM_RING_SIZE - 1)];
+}
+
+/* Read up to length bytes like Stream::readBytes(), less only at the end */
+size_t StreamRing::readBytes(char *out, size_t length)
+{
+   size_t done = 0;
+
+   while (done < length && (readPos != readEnd || WaitData())) {
+      size_t offset = readPos & (STREAM_RING_SIZE - 1);
+      size_t count  = min(min(readEnd - readPos, length - done), STREAM_RING_SIZE - offset);
+
+      memcpy(out + done, buffer + offset, count);
+      readPos += count;
+      done    += count;
+   }
+   return done;
+}
@@ -0,0 +1,74 @@
+/**
+  * @file Trig.h
+  *
+  * Fixed point sine and cosine from a table that the compiler builds,
+  * the circles, arcs and arrows of the display need no floating point math.
+  */
+#pragma once
+#include <stdint.h>
+
+#define TRIG_SHIFT 14                //!< Fraction bits of the fixed point values
+#define TRIG_ONE   (1 << TRIG_SHIFT) //!< Fixed point 1.0
+#define TRIG_STEPS 2                 //!< Table steps per degree, the compass ticks are 22.5 degrees apart
+
+/* Angle in table steps */
+constexpr int TrigAngle(int degrees)
+{
+   return degrees * TRIG_STEPS;
+}
+
+/* sin(0..90 degrees) * TRIG_ONE in table steps */
+struct SineTable
+{
+   int16_t value[90 * TRIG_STEPS + 1];
+};
+
+/* Rounded sine table, from the Taylor series which is exact enough for the fraction bits in the first quadrant */
+constexpr SineTable MakeSineTable()
+{
+   SineTable table = {};
+
+   for (int i = 0; i <= 90 * TRIG_STEPS; i++) {
+      double x    = i * 3.14159265358979323846 / (180 * TRIG_STEPS);
+      double term = x;
+      double sum  = x;
+
+      for (int n = 1; n < 12; n++) {
+         term = -term * x * x / ((2 * n) * (2 * n + 1));
+         sum += term;
+      }
+      table.value[i] = (int16_t) (sum * TRIG_ONE + 0.5);
+   }
+   return table;
+}
+
+constexpr SineTable sineTable = MakeSineTable();
+
+/* sin(angle) * TRIG_ONE of an angle in table steps, any sign and range */
+constexpr int FixedSin(int angle)
+{
+   angle %= TrigAngle(360);
+   if (angle < 0) {
+      angle += TrigAngle(360);
+   }
+   if (angle <= TrigAngle(90)) {
+      return sineTable.value[angle];
+   }
+   if (angle <= TrigAngle(180)) {
+      return sineTable.value[TrigAngle(180) - angle];
+   }
+   if (angle <= TrigAngle(270)) {
+      return -sineTable.value[angle - TrigAngle(180)];
+   }
+   return -sineTable.value[TrigAngle(360) - angle];
+}
+
+/* cos(angle) * TRIG_ONE of an angle in table steps */
+constexpr int FixedCos(int angle)
+{
+   return FixedSin(angle + TrigAngle(90));
+}
+
+static_assert(FixedSin(TrigAngle(30)) == TRIG_ONE / 2, "sine table is inexact");
+static_assert(FixedCos(TrigAngle(180)) == -TRIG_ONE, "cosine quadrants are wrong");
+static_assert(FixedSin(-TrigAngle(90)) == -TRIG_ONE, "negative angles are wrong");
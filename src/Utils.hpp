@@ -2,6 +2,9 @@
   * @file Utils.h
   * 
   * A collection of helper functions.
+  *
+  * The time_t conversions break the time into a local tmElements_t. year(), hour(), dayShortStr() and the
+  * other functions of the Time library share one static cache and buffer, the regions are drawn in parallel.
   */
 #pragma once
 #include <TimeLib.h> 
@@ -74,11 +77,13 @@ String getRTCTimeString()
 /* Convert the time_t to the YYYY/MM/DD HH:MM:SS format */
 String getDateTimeString(time_t rawtime)
 {
-   char buff[32];
+   char         buff[32];
+   tmElements_t tm;
    
+   breakTime(rawtime, tm);
    sprintf(buff,"%04d/%02d/%02d %02d:%02d:%02d",
-      year(rawtime), month(rawtime), day(rawtime),
-      hour(rawtime), minute(rawtime), second(rawtime));
+      tm.Year + 1970, tm.Month, tm.Day,
+      tm.Hour, tm.Minute, tm.Second);
 
    return (String) buff;
 }
@@ -86,27 +91,35 @@ String getDateTimeString(time_t rawtime)
 /* Convert the time_t to the date part YYYY/MM/DD */
 String getDateString(time_t rawtime)
 {
-   char buff[32];
+   char         buff[32];
+   tmElements_t tm;
    
+   breakTime(rawtime, tm);
    sprintf(buff,"%04d/%02d/%02d",
-      year(rawtime), month(rawtime), day(rawtime));
+      tm.Year + 1970, tm.Month, tm.Day);
 
    return (String) buff;
 }
 
-/* Convert the time_t to the date part MM/DD */
+/* Convert the time_t to the short name of the weekday */
 String getShortDayOfWeekString(time_t rawtime)
 {
-   return (String) dayShortStr(weekday(rawtime));
+   static const char *const names[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+   tmElements_t             tm;
+
+   breakTime(rawtime, tm);
+   return (String) names[tm.Wday - 1];
 }
 
 /* Convert the time_t to the time part HH:MM:SS format */
 String getTimeString(time_t rawtime)
 {
-   char buff[32];
+   char         buff[32];
+   tmElements_t tm;
    
+   breakTime(rawtime, tm);
    sprintf(buff,"%02d:%02d:%02d",
-      hour(rawtime), minute(rawtime), second(rawtime));
+      tm.Hour, tm.Minute, tm.Second);
 
    return (String) buff;
 }
@@ -114,10 +127,12 @@ String getTimeString(time_t rawtime)
 /* Convert the hour of the time_t */
 String getHourString(time_t rawtime)
 {
-   char buff[32];
+   char         buff[32];
+   tmElements_t tm;
    
+   breakTime(rawtime, tm);
    sprintf(buff,"%02d",
-      hour(rawtime));
+      tm.Hour);
 
    return (String) buff;
 }
@@ -125,10 +140,12 @@ String getHourString(time_t rawtime)
 /* Convert the minute of the time_t */
 String getHourMinString(time_t rawtime)
 {
-   char buff[32];
+   char         buff[32];
+   tmElements_t tm;
    
+   breakTime(rawtime, tm);
    sprintf(buff,"%02d:%02d",
-      hour(rawtime), minute(rawtime));
+      tm.Hour, tm.Minute);
 
    return (String) buff;
 }
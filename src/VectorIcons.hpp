@@ -0,0 +1,279 @@
+/**
+  * @file VectorIcons.h
+  *
+  * Weather icons drawn from compact vector paths with the canvas fill functions at any size.
+  */
+#pragma once
+#include <M5EPD.h>
+#include "IconFormat.hpp"
+
+/**
+  * Commands of a vector path, followed by their arguments as bytes.
+  * Coordinates are in a 256 x 256 grid, which is scaled to the requested icon size.
+  */
+enum VectorOp : uint8_t
+{
+   VEC_END,      //!< End of the path
+   VEC_BLACK,    //!< Following shapes are black (default)
+   VEC_WHITE,    //!< Following shapes are white, used to cut out outlines
+   VEC_CIRCLE,   //!< cx, cy, r
+   VEC_RECT,     //!< x, y, w, h
+   VEC_TRIANGLE, //!< x0, y0, x1, y1, x2, y2
+   VEC_LINE,     //!< x0, y0, x1, y1, width: line with round caps
+   VEC_SHAPE     //!< shape, x, y, size - 1: draw one of VECTOR_SHAPES into the box at x, y
+};
+
+/* Symbols the weather icons are composed of */
+enum VectorShape : uint8_t
+{
+   VEC_SHAPE_SUN,
+   VEC_SHAPE_MOON,
+   VEC_SHAPE_CLOUD,
+   VEC_SHAPE_RAIN,
+   VEC_SHAPE_BOLT,
+   VEC_SHAPE_SNOW,
+   VEC_SHAPE_MIST,
+   VEC_SHAPE_COUNT
+};
+
+static constexpr uint8_t VEC_SUN[] = {
+   VEC_CIRCLE, 128, 128, 44,
+   VEC_WHITE,
+   VEC_CIRCLE, 128, 128, 32,
+   VEC_BLACK,
+   VEC_LINE, 190, 128, 224, 128, 12,
+   VEC_LINE, 172, 172, 196, 196, 12,
+   VEC_LINE, 128, 190, 128, 224, 12,
+   VEC_LINE,  84, 172,  60, 196, 12,
+   VEC_LINE,  66, 128,  32, 128, 12,
+   VEC_LINE,  84,  84,  60,  60, 12,
+   VEC_LINE, 128,  66, 128,  32, 12,
+   VEC_LINE, 172,  84, 196,  60, 12,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_MOON[] = {
+   VEC_CIRCLE, 116, 128, 84,
+   VEC_WHITE,
+   VEC_CIRCLE, 164,  96, 72,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_CLOUD[] = {
+   VEC_CIRCLE,  72, 120, 44,
+   VEC_CIRCLE, 128,  80, 60,
+   VEC_CIRCLE, 184, 116, 48,
+   VEC_RECT,    72, 100, 112, 64,
+   VEC_WHITE,
+   VEC_CIRCLE,  72, 120, 32,
+   VEC_CIRCLE, 128,  80, 48,
+   VEC_CIRCLE, 184, 116, 36,
+   VEC_RECT,    72, 100, 112, 52,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_RAIN[] = {
+   VEC_LINE, 100, 184,  84, 232, 12,
+   VEC_LINE, 140, 184, 124, 232, 12,
+   VEC_LINE, 180, 184, 164, 232, 12,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_BOLT[] = {
+   VEC_TRIANGLE, 150, 148, 104, 208, 148, 200,
+   VEC_TRIANGLE, 118, 196, 152, 196, 108, 252,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_SNOW[] = {
+   VEC_LINE, 128,  32, 128, 224, 14,
+   VEC_LINE, 211,  80,  45, 176, 14,
+   VEC_LINE, 211, 176,  45,  80, 14,
+   VEC_LINE, 128,  64, 107,  43, 12,
+   VEC_LINE, 128,  64, 149,  43, 12,
+   VEC_LINE, 183,  96, 191,  67, 12,
+   VEC_LINE, 183,  96, 212, 104, 12,
+   VEC_LINE, 183, 160, 212, 152, 12,
+   VEC_LINE, 183, 160, 191, 189, 12,
+   VEC_LINE, 128, 192, 149, 213, 12,
+   VEC_LINE, 128, 192, 107, 213, 12,
+   VEC_LINE,  73, 160,  65, 189, 12,
+   VEC_LINE,  73, 160,  44, 152, 12,
+   VEC_LINE,  73,  96,  44, 104, 12,
+   VEC_LINE,  73,  96,  65,  67, 12,
+   VEC_END
+};
+
+static constexpr uint8_t VEC_MIST[] = {
+   VEC_LINE, 48,  84, 208,  84, 16,
+   VEC_LINE, 32, 128, 224, 128, 16,
+   VEC_LINE, 48, 172, 208, 172, 16,
+   VEC_END
+};
+
+static constexpr const uint8_t *VECTOR_SHAPES[VEC_SHAPE_COUNT] = {
+   VEC_SUN, VEC_MOON, VEC_CLOUD, VEC_RAIN, VEC_BOLT, VEC_SNOW, VEC_MIST
+};
+
+static constexpr uint8_t VEC_ICON_01D[] = { VEC_SHAPE, VEC_SHAPE_SUN, 0, 0, 255, VEC_END };
+static constexpr uint8_t VEC_ICON_02D[] = { VEC_SHAPE, VEC_SHAPE_SUN,  96, 8, 143, VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 64, 191, VEC_END };
+static constexpr uint8_t VEC_ICON_02N[] = { VEC_SHAPE, VEC_SHAPE_MOON, 96, 8, 143, VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 64, 191, VEC_END };
+static constexpr uint8_t VEC_ICON_03D[] = { VEC_SHAPE, VEC_SHAPE_SUN,  136, 4, 111, VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 40, 223, VEC_END };
+static constexpr uint8_t VEC_ICON_03N[] = { VEC_SHAPE, VEC_SHAPE_MOON, 148, 0, 107, VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 40, 223, VEC_END };
+static constexpr uint8_t VEC_ICON_04[]  = { VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 36, 255, VEC_END };
+static constexpr uint8_t VEC_ICON_09[]  = { VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 0, 255, VEC_SHAPE, VEC_SHAPE_RAIN, 0, 0, 255, VEC_END };
+static constexpr uint8_t VEC_ICON_10D[] = { VEC_SHAPE, VEC_SHAPE_SUN,  136, 0, 111, VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 0, 255, VEC_SHAPE, VEC_SHAPE_RAIN, 0, 0, 255, VEC_END };
+static constexpr uint8_t VEC_ICON_11[]  = { VEC_SHAPE, VEC_SHAPE_CLOUD, 0, 0, 255, VEC_SHAPE, VEC_SHAPE_BOLT, 0, 0, 255, VEC_END };
+static constexpr uint8_t VEC_ICON_13[]  = { VEC_SHAPE, VEC_SHAPE_SNOW, 16, 16, 223, VEC_END };
+static constexpr uint8_t VEC_ICON_50[]  = { VEC_SHAPE, VEC_SHAPE_MIST, 0, 0, 255, VEC_END };
+
+/* Vector path of one icon */
+struct VectorIcon
+{
+   IconId         icon; //!< Replaced bitmap icon
+   const uint8_t *path; //!< Vector path
+};
+
+/* The weather icons with a vector path, all others are drawn as bitmap */
+static constexpr VectorIcon VECTOR_ICONS[] = {
+   { ICON_ID_01D, VEC_ICON_01D },
+   { ICON_ID_02D, VEC_ICON_02D },
+   { ICON_ID_02N, VEC_ICON_02N },
+   { ICON_ID_03D, VEC_ICON_03D },
+   { ICON_ID_03N, VEC_ICON_03N },
+   { ICON_ID_04D, VEC_ICON_04  },
+   { ICON_ID_09D, VEC_ICON_09  },
+   { ICON_ID_09N, VEC_ICON_09  },
+   { ICON_ID_10D, VEC_ICON_10D },
+   { ICON_ID_11D, VEC_ICON_11  },
+   { ICON_ID_11N, VEC_ICON_11  },
+   { ICON_ID_13D, VEC_ICON_13  },
+   { ICON_ID_13N, VEC_ICON_13  },
+   { ICON_ID_50D, VEC_ICON_50  },
+   { ICON_ID_50N, VEC_ICON_50  }
+};
+
+/* Get the vector path of an icon, NULL if it only exists as bitmap */
+inline const uint8_t *GetVectorIcon(IconId id)
+{
+   for (const VectorIcon &entry : VECTOR_ICONS) {
+      if (entry.icon == id) {
+         return entry.path;
+      }
+   }
+   return NULL;
+}
+
+/* Integer square root */
+inline int32_t ISqrt(int32_t value)
+{
+   int32_t root = 0;
+
+   for (int32_t bit = 1 << 30; bit > 0; bit >>= 2) {
+      if (value >= root + bit) {
+         value -= root + bit;
+         root    = (root >> 1) + bit;
+      } else {
+         root >>= 1;
+      }
+   }
+   return root;
+}
+
+/**
+  * Placement of a path on the canvas in 1/65536 pixels:
+  * a grid coordinate v is drawn at (origin + v * scale) / 65536.
+  */
+struct VectorTransform
+{
+   int32_t originX; //!< Left border of the grid
+   int32_t originY; //!< Top border of the grid
+   int32_t scale;   //!< Size of one grid unit
+
+   int32_t X(uint8_t v) const { return (originX + v * scale + 32768) >> 16; }
+   int32_t Y(uint8_t v) const { return (originY + v * scale + 32768) >> 16; }
+   int32_t R(uint8_t v) const { return (v * scale + 32768) >> 16; }
+};
+
+/* Rounded integer division */
+inline int32_t DivRound(int32_t value, int32_t divisor)
+{
+   return (value >= 0 ? value + divisor / 2 : value - divisor / 2) / divisor;
+}
+
+/* Draw a line with round caps as two triangles and two circles */
+inline void DrawVectorLine(M5EPD_Canvas &target, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t width, uint32_t color)
+{
+   int32_t dx     = x1 - x0;
+   int32_t dy     = y1 - y0;
+   int32_t length = ISqrt(dx * dx + dy * dy);
+   int32_t r      = width / 2;
+
+   if (length > 0 && r > 0) {
+      int32_t ox = DivRound(-dy * r, length);
+      int32_t oy = DivRound( dx * r, length);
+
+      target.fillTriangle(x0 + ox, y0 + oy, x1 + ox, y1 + oy, x1 - ox, y1 - oy, color);
+      target.fillTriangle(x0 + ox, y0 + oy, x1 - ox, y1 - oy, x0 - ox, y0 - oy, color);
+   } else {
+      target.drawLine(x0, y0, x1, y1, color);
+   }
+   if (r > 0) {
+      target.fillCircle(x0, y0, r, color);
+      target.fillCircle(x1, y1, r, color);
+   }
+}
+
+/* Draw one vector path, shapes are drawn recursively */
+inline void DrawVectorPath(M5EPD_Canvas &target, const uint8_t *path, const VectorTransform &t)
+{
+   uint32_t color = M5EPD_Canvas::G15;
+
+   for (;;) {
+      const uint8_t *a = path + 1;
+
+      switch (*path) {
+         case VEC_BLACK:
+            color = M5EPD_Canvas::G15;
+            path += 1;
+            break;
+         case VEC_WHITE:
+            color = M5EPD_Canvas::G0;
+            path += 1;
+            break;
+         case VEC_CIRCLE:
+            target.fillCircle(t.X(a[0]), t.Y(a[1]), t.R(a[2]), color);
+            path += 4;
+            break;
+         case VEC_RECT:
+            target.fillRect(t.X(a[0]), t.Y(a[1]), t.R(a[2]), t.R(a[3]), color);
+            path += 5;
+            break;
+         case VEC_TRIANGLE:
+            target.fillTriangle(t.X(a[0]), t.Y(a[1]), t.X(a[2]), t.Y(a[3]), t.X(a[4]), t.Y(a[5]), color);
+            path += 7;
+            break;
+         case VEC_LINE:
+            DrawVectorLine(target, t.X(a[0]), t.Y(a[1]), t.X(a[2]), t.Y(a[3]), t.R(a[4]), color);
+            path += 6;
+            break;
+         case VEC_SHAPE: {
+            VectorTransform shape = { t.originX + a[1] * t.scale, t.originY + a[2] * t.scale, t.scale * (a[3] + 1) / 256 };
+
+            DrawVectorPath(target, VECTOR_SHAPES[a[0]], shape);
+            path += 5;
+            break;
+         }
+         default:
+            return;
+      }
+   }
+}
+
+/* Draw a vector icon into the size x size box at x, y */
+inline void DrawVectorIcon(M5EPD_Canvas &target, int x, int y, int size, const uint8_t *path)
+{
+   VectorTransform t = { x * 65536, y * 65536, size * 256 };
+
+   DrawVectorPath(target, path, t);
+}
@@ -0,0 +1,66 @@
+/**
+  * @file Waveform.h
+  *
+  * Selection of the EPD update mode by the content of an area. Black and white areas are
+  * updated with the fast DU and A2 waveforms, gray areas with GL16. They leave some ghosting
+  * behind, so a panel gets a GC16 update after WAVEFORM_MAX_PARTIAL of these updates.
+  */
+#pragma once
+#include "Panels.hpp"
+#include "RasterTarget.hpp"
+
+// Update all areas with GC16 like a full refresh.
+// #define USE_GC16_ONLY 1
+
+#define WAVEFORM_MAX_PARTIAL 8 //!< DU, A2 and GL16 updates of a panel until its GC16 cleanup
+
+/* A pixel pair or word of pixels is black and white if all 4 bits of every nibble are equal */
+#define BLACK_WHITE_MASK 0x77777777u
+
+/**
+  * Check if all pixels of the area of a 4bpp frame are black or white.
+  * x must be even, a row of an odd width is checked with its padding pixel.
+  */
+bool IsBlackWhite(const uint8_t *frame, int stride, const PanelRect &area)
+{
+   int bytes = (area.w + 1) / 2;
+
+   for (int y = area.y; y < area.y + area.h; y++) {
+      const uint8_t *row = frame + y * stride + area.x / 2;
+      int            i   = 0;
+
+      for (; i + 4 <= bytes; i += 4) {
+         uint32_t word = LoadWord4(row + i);
+
+         if (((word ^ (word >> 1)) & BLACK_WHITE_MASK) != 0) {
+            return false;
+         }
+      }
+      for (; i < bytes; i++) {
+         if (((row[i] ^ (row[i] >> 1)) & BLACK_WHITE_MASK & 0xFF) != 0) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+/**
+  * Update mode of a changed area: A2 if the area stays black and white, DU if the new content
+  * is black and white and GL16 for grays. previous is the displayed frame with the stride of the
+  * current frame, NULL if the displayed content of the area is unknown.
+  */
+m5epd_update_mode_t SelectUpdateMode(const uint8_t *current, const uint8_t *previous, int stride, const PanelRect &area)
+{
+#ifdef USE_GC16_ONLY
+   return UPDATE_MODE_GC16;
+#else
+   if (!IsBlackWhite(current, stride, area)) {
+      return UPDATE_MODE_GL16;
+   }
+   if (previous != NULL && IsBlackWhite(previous, stride, area)) {
+      return UPDATE_MODE_A2;
+   }
+   return UPDATE_MODE_DU;
+#endif
+}
@@ -8,11 +8,56 @@
 #include <WiFiClient.h>
 #include <ArduinoJson.h>
 #include "Utils.hpp"
+#include "RenderPool.hpp"
+#include "StreamRing.hpp"
+#include "JsonPeakAllocator.hpp"
+
+// Read the http response on the other core into a ring buffer while this core parses it.
+// #define STREAM_PARSE 1
+
+// Print the peak heap usage of the JsonDocument after every parse.
+// #define JSON_MEMORY_REPORT 1
+
+// Parse the response with the WeatherParser directly into the fields instead of a JsonDocument.
+// #define SAX_PARSE 1
 
 #define MAX_HOURLY   24
 #define MAX_FORECAST  8
 #define MIN_RAIN     5
 
+#define WEATHER_MAIN_SIZE 16 //!< Longest description "Thunderstorm" with room to spare
+#define WEATHER_ICON_SIZE  4 //!< Icon codes like "10d"
+
+/* Copy a string value into a text field, truncated to its size, NULL gives an empty text */
+template <size_t Size>
+void CopyText(char (&text)[Size], const char *value)
+{
+   size_t length = 0;
+
+   if (value != NULL) {
+      length = min(strlen(value), Size - 1);
+      memcpy(text, value, length);
+   }
+   text[length] = 0;
+}
+
+template <typename Reader>
+class WeatherParser;
+
+/**
+  * The fields read by Weather::Fill(), deserializeJson() skips all other fields of the response.
+  * The filter of the first array element applies to all elements. Keep it in sync with Fill().
+  */
+static constexpr char weatherFilter[] = R"({
+   "timezone_offset": true,
+   "current": { "dt": true, "sunrise": true, "sunset": true, "wind_deg": true, "wind_speed": true, "temp": true,
+                "rain": { "1h": true }, "pop": true, "pressure": true, "weather": [ { "main": true, "icon": true } ] },
+   "hourly":  [ { "dt": true, "temp": true, "rain": { "1h": true }, "pop": true, "pressure": true,
+                  "weather": [ { "main": true, "icon": true } ] } ],
+   "daily":   [ { "dt": true, "temp": { "max": true, "min": true }, "rain": true, "pop": true, "pressure": true,
+                  "weather": [ { "icon": true } ] } ]
+})";
+
 /**
   * Class for reading all the weather data from openweathermap.
   */
@@ -34,8 +79,8 @@ public:
    float  hourlyRain[MAX_HOURLY];          //!< max rain in mm
    float  hourlyPop[MAX_HOURLY];           //!< pop of the hourly forecast
    float  hourlyPressure[MAX_HOURLY];      //!< air pressure
-   String hourlyMain[MAX_HOURLY];          //!< description of the hourly forecast
-   String hourlyIcon[MAX_HOURLY];          //!< openweathermap icon of the forecast weather
+   char   hourlyMain[MAX_HOURLY][WEATHER_MAIN_SIZE]; //!< description of the hourly forecast
+   char   hourlyIcon[MAX_HOURLY][WEATHER_ICON_SIZE]; //!< openweathermap icon of the forecast weather
 
    time_t forecastTime[MAX_FORECAST];      //!< timestamp of the daily forecast
    int    forecastTempRange[2];            //!< min/max temp of the daily forecast
@@ -45,17 +90,21 @@ public:
    float  forecastRain[MAX_FORECAST];      //!< max rain in mm
    float  forecastPop[MAX_FORECAST];       //!< pop of the dayly forecast
    float  forecastPressure[MAX_FORECAST];  //!< air pressure
-   String forecastIcon[MAX_FORECAST];      //!< openweathermap icon of the forecast weather
+   char   forecastIcon[MAX_FORECAST][WEATHER_ICON_SIZE]; //!< openweathermap icon of the forecast weather
 
 protected:
+   template <typename Reader>
+   friend class WeatherParser;
+
    /* Convert UTC time to local time */
    time_t LocalTime(time_t time)
    {
       return time + currentTimeOffset;
    }
 
-   /* Calls the openweathermap request and deserialisation the json data. */
-   bool GetOpenWeatherJsonDoc(JsonDocument &doc)
+   /* Calls the openweathermap request and parses the response with parse(reader). */
+   template <typename Parse>
+   bool Request(const Parse &parse)
    {
       WiFiClient client;
       HTTPClient http;
@@ -83,16 +132,54 @@ protected:
          return false;
       }
 
-      DeserializationError error = deserializeJson(doc, http.getStream());
+#ifdef STREAM_PARSE
+      bool parsed = ParseStream(http.getStream(), http.getSize(), parse);
+#else
+      bool parsed = parse(http.getStream());
+#endif
       http.end();
-      
-      if (error) {
-         Serial.print(F("deserializeJson() failed: "));
-         Serial.println(error.c_str());
-         return false;
+      return parsed;
+   }
+
+   /* Parse the response of the stream, size is the Content-Length or -1 if unknown */
+   template <typename Source, typename Parse>
+   bool ParseStream(Source &stream, int size, const Parse &parse)
+   {
+      StreamRing ring;
+
+      if (!ring.IsValid()) {
+         return parse(stream);
       }
-      
-      return true;
+      // a task on the other core copies the received bytes into the ring, the parser never waits in the network stack
+      std::thread reader = StartWorker(1, [&] { ring.Fill(stream, size); });
+
+      bool parsed = parse(ring);
+
+      ring.Close();
+      reader.join();
+      return parsed;
+   }
+
+   /* Parse the response with the parser selected by SAX_PARSE */
+   template <typename Reader>
+   bool Parse(Reader &reader)
+   {
+#ifdef SAX_PARSE
+      return ParseSax(reader);
+#else
+#ifdef JSON_MEMORY_REPORT
+      JsonPeakAllocator allocator;
+      JsonDocument      doc(&allocator);
+#else
+      JsonDocument doc;
+#endif
+      bool filled = ParseJson(reader, doc);
+
+#ifdef JSON_MEMORY_REPORT
+      Serial.printf("JsonDocument: %u bytes peak in %d allocations\n", (unsigned) allocator.Peak(), allocator.Count());
+#endif
+      return filled;
+#endif
    }
 
    /* Fill from the json data into the internal data. */
@@ -109,31 +196,24 @@ protected:
       windspeed         = root["current"]["wind_speed"].as<float>();
 
       JsonArray hourly_list = root["hourly"];
+      int       hourlyCount = 1;
       hourlyTime[0]    = LocalTime(root["current"]["dt"].as<int>());
       hourlyMaxTemp[0] = root["current"]["temp"].as<float>();
-      hourlyMain[0]    = root["current"]["weather"][0]["main"].as<const char *>();
+      CopyText(hourlyMain[0], root["current"]["weather"][0]["main"].as<const char *>());
       hourlyRain[0]    = root["current"]["rain"]["1h"].as<float>();
       hourlyPop[0]     = root["current"]["pop"].as<float>() * 100;
       hourlyPressure[0]= root["current"]["pressure"].as<float>();
-      hourlyIcon[0]    = root["current"]["weather"][0]["icon"].as<const char *>();
+      CopyText(hourlyIcon[0], root["current"]["weather"][0]["icon"].as<const char *>());
       for (int i = 1; i < MAX_HOURLY; i++) {
          if (i < hourly_list.size()) {
             hourlyTime[i]    = LocalTime(hourly_list[i - 1]["dt"].as<int>());
             hourlyMaxTemp[i] = hourly_list[i - 1]["temp"].as<float>();
-            hourlyMain[i]    = hourly_list[i - 1]["weather"][0]["main"].as<const char *>();
+            CopyText(hourlyMain[i], hourly_list[i - 1]["weather"][0]["main"].as<const char *>());
             hourlyRain[i]    = hourly_list[i - 1]["rain"]["1h"].as<float>();
             hourlyPop[i]     = hourly_list[i - 1]["pop"].as<float>() * 100;
             hourlyPressure[i]= hourly_list[i - 1]["pressure"].as<float>();
-            hourlyIcon[i]    = hourly_list[i - 1]["weather"][0]["icon"].as<const char *>();
-            if (hourlyRain[i] > hourlyMaxRain) {
-               hourlyMaxRain = hourlyRain[i] + 4;
-            }
-            if (hourlyMaxTemp[i] + 2 > hourlyTempRange[1]) {
-               hourlyTempRange[1] = (int)((hourlyMaxTemp[i] + 2) / 5) * 5 + 5;
-            }
-            if (hourlyMaxTemp[i] - 2 < hourlyTempRange[0]) {
-               hourlyTempRange[0] = (int)((hourlyMaxTemp[i] - 2) / 5) * 5 - 5;
-            }
+            CopyText(hourlyIcon[i], hourly_list[i - 1]["weather"][0]["icon"].as<const char *>());
+            hourlyCount++;
          }
       }
       
@@ -146,8 +226,28 @@ protected:
             forecastRain[i]     = dayly_list[i]["rain"].as<float>();
             forecastPop[i]      = dayly_list[i]["pop"].as<float>() * 100;
             forecastPressure[i] = dayly_list[i]["pressure"].as<float>();
-            forecastIcon[i]     = dayly_list[i]["weather"][0]["icon"].as<const char *>();
+            CopyText(forecastIcon[i], dayly_list[i]["weather"][0]["icon"].as<const char *>());
          }
+      }
+      UpdateRanges(hourlyCount);
+      return true;
+   }
+
+   /* The ranges of the graphs, from the first hourlyCount hourly and all daily forecasts. */
+   void UpdateRanges(int hourlyCount)
+   {
+      for (int i = 1; i < hourlyCount; i++) {
+         if (hourlyRain[i] > hourlyMaxRain) {
+            hourlyMaxRain = hourlyRain[i] + 4;
+         }
+         if (hourlyMaxTemp[i] + 2 > hourlyTempRange[1]) {
+            hourlyTempRange[1] = (int)((hourlyMaxTemp[i] + 2) / 5) * 5 + 5;
+         }
+         if (hourlyMaxTemp[i] - 2 < hourlyTempRange[0]) {
+            hourlyTempRange[0] = (int)((hourlyMaxTemp[i] - 2) / 5) * 5 - 5;
+         }
+      }
+      for (int i = 0; i < MAX_FORECAST; i++) {
          if (forecastRain[i] > forecastMaxRain) {
             forecastMaxRain = forecastRain[i] + 4;
          }
@@ -158,8 +258,6 @@ protected:
             forecastTempRange[0] = (int)((forecastMinTemp[i] - 2) / 5) * 5 - 5;
          }
       }
-          
-      return true;
    }
 
 public:
@@ -202,11 +300,47 @@ public:
    /* Start the request and the filling. */
    bool Get()
    {
-      JsonDocument doc;
-   
-      if (GetOpenWeatherJsonDoc(doc)) {
-         return Fill(doc.as<JsonObject>());
+      return Request([this](auto &reader) { return Parse(reader); });
+   }
+
+   /* The filter document of weatherFilter, deserialized once on the first parse and kept. */
+   static const JsonDocument &FilterDocument()
+   {
+      static const JsonDocument filter = [] {
+         JsonDocument doc;
+
+         deserializeJson(doc, weatherFilter);
+         return doc;
+      }();
+
+      return filter;
+   }
+
+   /* Deserialize the response with the filter into doc and fill the fields from it. */
+   template <typename Reader>
+   bool ParseJson(Reader &reader, JsonDocument &doc)
+   {
+      DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(FilterDocument()));
+
+      if (error) {
+         Serial.print(F("deserializeJson() failed: "));
+         Serial.println(error.c_str());
+         return false;
       }
-      return false;
+      return Fill(doc.as<JsonObject>());
    }
+
+   template <typename Reader>
+   bool ParseSax(Reader &reader);
 };
+
+#include "WeatherParser.hpp"
+
+/* Parse the response with the WeatherParser directly into the fields, without a JsonDocument. */
+template <typename Reader>
+bool Weather::ParseSax(Reader &reader)
+{
+   WeatherParser<Reader> parser(*this, reader);
+
+   return parser.Parse();
+}
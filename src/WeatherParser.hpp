@@ -0,0 +1,672 @@
+/**
+  * @file WeatherParser.h
+  *
+  * Event driven parser of the openweathermap OneCall response, writes the values
+  * directly into the Weather fields without a JsonDocument.
+  */
+#pragma once
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+
+#define WEATHER_PARSER_DEPTH 6  //!< Deepest path with a used value: hourly[i].weather[0].main
+#define WEATHER_TOKEN_SIZE   24 //!< Longest key or string kept while parsing
+
+/* The keys of the paths read by Weather::Fill(), all other keys are skipped with their values */
+enum WeatherKey : uint8_t
+{
+   KEY_OTHER,
+   KEY_ELEMENT, //!< Array element, the index is in the path entry
+   KEY_TIMEZONE_OFFSET,
+   KEY_CURRENT,
+   KEY_HOURLY,
+   KEY_DAILY,
+   KEY_DT,
+   KEY_SUNRISE,
+   KEY_SUNSET,
+   KEY_WIND_DEG,
+   KEY_WIND_SPEED,
+   KEY_TEMP,
+   KEY_RAIN,
+   KEY_1H,
+   KEY_POP,
+   KEY_PRESSURE,
+   KEY_WEATHER,
+   KEY_MAIN,
+   KEY_ICON,
+   KEY_MAX,
+   KEY_MIN
+};
+
+static const char *const WEATHER_KEY_NAMES[] = {
+   "", "", "timezone_offset", "current", "hourly", "daily", "dt", "sunrise", "sunset", "wind_deg", "wind_speed",
+   "temp", "rain", "1h", "pop", "pressure", "weather", "main", "icon", "max", "min"
+};
+
+/* A scalar JSON value, converted like the as<int>() and as<float>() of ArduinoJson */
+struct WeatherValue
+{
+   bool    isString;  //!< text holds a string
+   bool    isInteger; //!< integer holds the value, else number
+   int64_t integer;   //!< Integer without fraction and exponent
+   double  number;    //!< All other numbers
+   char   *text;      //!< String value, truncated to WEATHER_TOKEN_SIZE - 1 bytes
+
+   int AsInt() const
+   {
+      if (isString) {
+         return 0;
+      }
+      if (isInteger) {
+         return integer >= INT32_MIN && integer <= INT32_MAX ? (int) integer : 0;
+      }
+      return number >= INT32_MIN && number <= INT32_MAX ? (int) number : 0;
+   }
+
+   float AsFloat() const
+   {
+      return isString ? 0 : isInteger ? (float) integer : (float) number;
+   }
+};
+
+/* Values of an hourly forecast, kept until the next one starts like Fill() skips the last entry */
+struct HourlyEntry
+{
+   time_t time;                     //!< UTC timestamp
+   float  temp;                     //!< Temperature
+   float  rain;                     //!< Rain in mm
+   float  pop;                      //!< Probability of precipitation 0..1
+   float  pressure;                 //!< Air pressure
+   char   main[WEATHER_MAIN_SIZE];  //!< Description
+   char   icon[WEATHER_ICON_SIZE];  //!< openweathermap icon
+};
+
+/**
+  * Recursive descent parser reading the response once. It keeps the path of the current value as
+  * key ids and array indices and writes the values of the paths Fill() reads into the Weather fields.
+  * Other values are skipped without parsing them, only their strings and brackets are followed.
+  * Nothing is allocated, the state is a few hundred bytes on the stack. The result is the same as
+  * Fill() with a JsonDocument of the same response, except for numbers sent as strings, which read as 0.
+  * Every character comes from reader.readBytes(), which waits for the network up to its timeout,
+  * read() of a WiFiClient returns -1 while the next packet has not arrived. Nothing is read after
+  * the root object, the connection may stay open.
+  */
+template <typename Reader>
+class WeatherParser
+{
+protected:
+   struct PathEntry
+   {
+      WeatherKey key;   //!< Key of the member or KEY_ELEMENT
+      int        index; //!< Index of the array element
+   };
+
+   Weather    &weather;                          //!< Result
+   Reader     &reader;                           //!< Source of the response
+   int         c;                                //!< Current character, -1 at the end
+   size_t      position;                         //!< Bytes read, for the error messages
+   int         depth;                            //!< Entries in path
+   PathEntry   path[WEATHER_PARSER_DEPTH];       //!< Path of the current value
+   char        token[WEATHER_TOKEN_SIZE];        //!< Current key or string
+   HourlyEntry current;                          //!< Current weather, the first hourly forecast
+   HourlyEntry hourly;                           //!< Hourly forecast waiting for the next one
+   int         hourlyCount;                      //!< Hourly forecasts in weather including the current weather
+   int         forecastCount;                    //!< Daily forecasts in weather
+
+public:
+   WeatherParser(Weather &weather, Reader &reader)
+      : weather(weather)
+      , reader(reader)
+      , c(0)
+      , position(0)
+      , depth(0)
+      , hourlyCount(1)
+      , forecastCount(0)
+   {
+      memset(&current, 0, sizeof(current));
+      memset(&hourly,  0, sizeof(hourly));
+   }
+
+   bool Parse();
+
+protected:
+   void Next()
+   {
+      char ch;
+
+      c = reader.readBytes(&ch, 1) == 1 ? (uint8_t) ch : -1;
+      position++;
+   }
+
+   /* Step over the closing bracket of a value, the root object ends the response */
+   bool Close()
+   {
+      if (depth > 0) {
+         Next();
+      }
+      return true;
+   }
+
+   void SkipSpace()
+   {
+      while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+         Next();
+      }
+   }
+
+   bool Fail(const char *reason)
+   {
+      Serial.printf("WeatherParser: %s at byte %u\n", reason, (unsigned) position);
+      return false;
+   }
+
+   bool ParseValue();
+   bool ParseObject();
+   bool ParseArray();
+   bool ParseString();
+   bool ParseNumber(WeatherValue &value);
+   bool ParseLiteral(const char *literal);
+   bool SkipValue();
+   bool Wanted() const;
+   void OnElement();
+   void OnValue(const WeatherValue &value);
+   bool SetHourly(HourlyEntry &entry, int level, const WeatherValue &value);
+   void Finish();
+};
+
+/* Parse the whole response, false on syntax errors */
+template <typename Reader>
+bool WeatherParser<Reader>::Parse()
+{
+   weather.Clear();
+   Next();
+   SkipSpace();
+   if (c != '{') {
+      return Fail("no object");
+   }
+   if (!ParseValue()) {
+      return false;
+   }
+   Finish();
+   return true;
+}
+
+/* Parse the value at c, the path is the one of the value */
+template <typename Reader>
+bool WeatherParser<Reader>::ParseValue()
+{
+   WeatherValue value = { false, false, 0, 0, token };
+
+   SkipSpace();
+   switch (c) {
+      case '{': return ParseObject();
+      case '[': return ParseArray();
+      case '"':
+         if (!ParseString()) {
+            return false;
+         }
+         value.isString = true;
+         break;
+      case 't':
+         value.isInteger = true;
+         value.integer   = 1;
+         if (!ParseLiteral("true")) {
+            return false;
+         }
+         break;
+      case 'f':
+         value.isInteger = true;
+         if (!ParseLiteral("false")) {
+            return false;
+         }
+         break;
+      case 'n':
+         // null leaves the field at its default
+         return ParseLiteral("null");
+      default:
+         if (!ParseNumber(value)) {
+            return false;
+         }
+         break;
+   }
+   OnValue(value);
+   return true;
+}
+
+template <typename Reader>
+bool WeatherParser<Reader>::ParseObject()
+{
+   Next();
+   SkipSpace();
+   if (c == '}') {
+      return Close();
+   }
+   while (true) {
+      SkipSpace();
+      if (c != '"') {
+         return Fail("key expected");
+      }
+      if (!ParseString()) {
+         return false;
+      }
+      SkipSpace();
+      if (c != ':') {
+         return Fail("':' expected");
+      }
+      Next();
+
+      WeatherKey key = KEY_OTHER;
+
+      for (int i = KEY_TIMEZONE_OFFSET; i <= KEY_MIN; i++) {
+         if (strcmp(token, WEATHER_KEY_NAMES[i]) == 0) {
+            key = (WeatherKey) i;
+            break;
+         }
+      }
+      if (depth < WEATHER_PARSER_DEPTH) {
+         path[depth++] = { key, 0 };
+         if (!(Wanted() ? ParseValue() : SkipValue())) {
+            return false;
+         }
+         depth--;
+      } else if (!SkipValue()) {
+         return false;
+      }
+      SkipSpace();
+      if (c == ',') {
+         Next();
+      } else if (c == '}') {
+         return Close();
+      } else {
+         return Fail("',' or '}' expected");
+      }
+   }
+}
+
+template <typename Reader>
+bool WeatherParser<Reader>::ParseArray()
+{
+   Next();
+   SkipSpace();
+   if (c == ']') {
+      Next();
+      return true;
+   }
+   for (int index = 0;; index++) {
+      if (depth < WEATHER_PARSER_DEPTH) {
+         path[depth++] = { KEY_ELEMENT, index };
+         OnElement();
+         if (!(Wanted() ? ParseValue() : SkipValue())) {
+            return false;
+         }
+         depth--;
+      } else if (!SkipValue()) {
+         return false;
+      }
+      SkipSpace();
+      if (c == ',') {
+         Next();
+      } else if (c == ']') {
+         Next();
+         return true;
+      } else {
+         return Fail("',' or ']' expected");
+      }
+   }
+}
+
+/* Read the string at c into token, truncated to its size, \u escapes are stored as UTF-8 */
+template <typename Reader>
+bool WeatherParser<Reader>::ParseString()
+{
+   int length = 0;
+
+   for (Next(); c != '"'; Next()) {
+      uint32_t code    = c;
+      bool     unicode = false;
+
+      if (c < 0x20) {
+         return Fail(c < 0 ? "unterminated string" : "control character in string");
+      }
+      if (c == '\\') {
+         Next();
+         switch (c) {
+            case 'b': code = '\b'; break;
+            case 'f': code = '\f'; break;
+            case 'n': code = '\n'; break;
+            case 'r': code = '\r'; break;
+            case 't': code = '\t'; break;
+            case '"': case '\\': case '/': code = c; break;
+            case 'u':
+               code    = 0;
+               unicode = true;
+               for (int i = 0; i < 4; i++) {
+                  Next();
+                  if (!isxdigit(c)) {
+                     return Fail("invalid \\u escape");
+                  }
+                  code = code * 16 + (isdigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+               }
+               break;
+            default:
+               return Fail("invalid escape");
+         }
+      }
+      // the bytes of the response are UTF-8 already, only the \u escapes above 0x7F are encoded
+      if (!unicode || code < 0x80) {
+         if (length + 1 < WEATHER_TOKEN_SIZE) {
+            token[length++] = code;
+         }
+      } else if (length + 3 < WEATHER_TOKEN_SIZE) {
+         if (code >= 0x800) {
+            token[length++] = 0xE0 | code >> 12;
+            token[length++] = 0x80 | (code >> 6 & 0x3F);
+         } else {
+            token[length++] = 0xC0 | code >> 6;
+         }
+         token[length++] = 0x80 | (code & 0x3F);
+      }
+   }
+   token[length] = 0;
+   Next();
+   return true;
+}
+
+/* Read the number at c like the JSON grammar, the conversion needs no heap like strtod() of newlib */
+template <typename Reader>
+bool WeatherParser<Reader>::ParseNumber(WeatherValue &value)
+{
+   bool     negative = c == '-';
+   uint64_t mantissa = 0;
+   int      exponent = 0;
+   int      digits   = 0;
+   bool     integer  = true;
+
+   if (negative) {
+      Next();
+   }
+   if (!isdigit(c)) {
+      return Fail("invalid value");
+   }
+   for (; isdigit(c); Next(), digits++) {
+      if (mantissa < UINT64_MAX / 10 - 9) {
+         mantissa = mantissa * 10 + (c - '0');
+      } else {
+         exponent++;
+         integer = false;
+      }
+   }
+   if (c == '.') {
+      integer = false;
+      Next();
+      if (!isdigit(c)) {
+         return Fail("invalid number");
+      }
+      for (; isdigit(c); Next()) {
+         if (mantissa < UINT64_MAX / 10 - 9) {
+            mantissa = mantissa * 10 + (c - '0');
+            exponent--;
+         }
+      }
+   }
+   if (c == 'e' || c == 'E') {
+      bool negativeExponent = false;
+      int  exponentDigits   = 0;
+
+      integer = false;
+      Next();
+      if (c == '+' || c == '-') {
+         negativeExponent = c == '-';
+         Next();
+      }
+      if (!isdigit(c)) {
+         return Fail("invalid exponent");
+      }
+      for (; isdigit(c); Next()) {
+         exponentDigits = min(exponentDigits * 10 + (c - '0'), 9999);
+      }
+      exponent += negativeExponent ? -exponentDigits : exponentDigits;
+   }
+   if (integer && mantissa <= (uint64_t) INT64_MAX) {
+      value.isInteger = true;
+      value.integer   = negative ? -(int64_t) mantissa : (int64_t) mantissa;
+      return true;
+   }
+   // powers up to 1e22 are exact doubles, so the usual decimal fractions are rounded correctly
+   double scale = 1;
+
+   for (int i = 0; i < min(abs(exponent), 22); i++) {
+      scale *= 10;
+   }
+   if (abs(exponent) > 22) {
+      scale *= pow(10.0, abs(exponent) - 22);
+   }
+   value.number = (negative ? -1.0 : 1.0) * (exponent >= 0 ? mantissa * scale : mantissa / scale);
+   return true;
+}
+
+template <typename Reader>
+bool WeatherParser<Reader>::ParseLiteral(const char *literal)
+{
+   for (; *literal; literal++) {
+      if (c != *literal) {
+         return Fail("invalid literal");
+      }
+      Next();
+   }
+   return true;
+}
+
+/* Skip the value at c, only the strings and the nesting are followed */
+template <typename Reader>
+bool WeatherParser<Reader>::SkipValue()
+{
+   int nesting = 0;
+
+   SkipSpace();
+   while (true) {
+      switch (c) {
+         case -1:
+            return Fail("unexpected end");
+         case '"':
+            for (Next(); c != '"'; Next()) {
+               if (c == '\\') {
+                  Next();
+               }
+               if (c < 0) {
+                  return Fail("unterminated string");
+               }
+            }
+            Next();
+            if (nesting == 0) {
+               return true;
+            }
+            break;
+         case '{':
+         case '[':
+            nesting++;
+            Next();
+            break;
+         case '}':
+         case ']':
+            // at nesting 0 the bracket closes the parent after a number or literal
+            if (nesting == 0) {
+               return true;
+            }
+            Next();
+            if (--nesting == 0) {
+               return true;
+            }
+            break;
+         case ',':
+            if (nesting == 0) {
+               return true;
+            }
+            Next();
+            break;
+         default:
+            Next();
+            break;
+      }
+   }
+}
+
+/* Does the value of the path lead to a value Fill() reads */
+template <typename Reader>
+bool WeatherParser<Reader>::Wanted() const
+{
+   const PathEntry &last = path[depth - 1];
+
+   if (last.key == KEY_OTHER) {
+      return false;
+   }
+   if (depth == 1) {
+      return last.key == KEY_TIMEZONE_OFFSET || last.key == KEY_CURRENT || last.key == KEY_HOURLY || last.key == KEY_DAILY;
+   }
+   if (depth == 2 && last.key == KEY_ELEMENT) {
+      // Fill() reads the hourly forecasts 0 .. MAX_HOURLY - 2, the current weather is the first one
+      return (path[0].key == KEY_HOURLY && last.index < MAX_HOURLY - 1) || (path[0].key == KEY_DAILY && last.index < MAX_FORECAST);
+   }
+   // only the first weather description
+   return last.key != KEY_ELEMENT || last.index == 0;
+}
+
+/* Start of an array element, an hourly forecast is stored when the next one starts */
+template <typename Reader>
+void WeatherParser<Reader>::OnElement()
+{
+   if (depth != 2) {
+      return;
+   }
+   int index = path[1].index;
+
+   if (path[0].key == KEY_HOURLY && index > 0 && index < MAX_HOURLY) {
+      weather.hourlyTime[index]     = hourly.time;
+      weather.hourlyMaxTemp[index]  = hourly.temp;
+      weather.hourlyRain[index]     = hourly.rain;
+      weather.hourlyPop[index]      = hourly.pop * 100;
+      weather.hourlyPressure[index] = hourly.pressure;
+      strcpy(weather.hourlyMain[index], hourly.main);
+      strcpy(weather.hourlyIcon[index], hourly.icon);
+      hourlyCount = index + 1;
+   }
+   if (path[0].key == KEY_HOURLY) {
+      memset(&hourly, 0, sizeof(hourly));
+   }
+   if (path[0].key == KEY_DAILY && index < MAX_FORECAST) {
+      weather.forecastTime[index]     = 0;
+      weather.forecastMaxTemp[index]  = 0;
+      weather.forecastMinTemp[index]  = 0;
+      weather.forecastRain[index]     = 0;
+      weather.forecastPop[index]      = 0;
+      weather.forecastPressure[index] = 0;
+      weather.forecastIcon[index][0]  = 0;
+      forecastCount = index + 1;
+   }
+}
+
+/* Store the value of an hourly forecast, level is the depth of the forecast object */
+template <typename Reader>
+bool WeatherParser<Reader>::SetHourly(HourlyEntry &entry, int level, const WeatherValue &value)
+{
+   WeatherKey key = path[level].key;
+
+   if (depth == level + 1) {
+      switch (key) {
+         case KEY_DT:       entry.time     = value.AsInt();   return true;
+         case KEY_TEMP:     entry.temp     = value.AsFloat(); return true;
+         case KEY_POP:      entry.pop      = value.AsFloat(); return true;
+         case KEY_PRESSURE: entry.pressure = value.AsFloat(); return true;
+         default:                                             return false;
+      }
+   }
+   if (depth == level + 2 && key == KEY_RAIN && path[level + 1].key == KEY_1H) {
+      entry.rain = value.AsFloat();
+      return true;
+   }
+   if (depth == level + 3 && key == KEY_WEATHER && value.isString) {
+      switch (path[level + 2].key) {
+         case KEY_MAIN: CopyText(entry.main, value.text); return true;
+         case KEY_ICON: CopyText(entry.icon, value.text); return true;
+         default:                                          return false;
+      }
+   }
+   return false;
+}
+
+/* A scalar value, stored if Fill() reads its path */
+template <typename Reader>
+void WeatherParser<Reader>::OnValue(const WeatherValue &value)
+{
+   WeatherKey key = path[depth - 1].key;
+
+   switch (path[0].key) {
+      case KEY_TIMEZONE_OFFSET:
+         weather.currentTimeOffset = value.AsInt();
+         break;
+      case KEY_CURRENT:
+         if (SetHourly(current, 1, value) || depth != 2) {
+            break;
+         }
+         switch (key) {
+            case KEY_SUNRISE:    weather.sunrise   = value.AsInt();   break;
+            case KEY_SUNSET:     weather.sunset    = value.AsInt();   break;
+            case KEY_WIND_DEG:   weather.winddir   = value.AsFloat(); break;
+            case KEY_WIND_SPEED: weather.windspeed = value.AsFloat(); break;
+            default:                                                  break;
+         }
+         break;
+      case KEY_HOURLY:
+         if (depth >= 3) {
+            SetHourly(hourly, 2, value);
+         }
+         break;
+      case KEY_DAILY: {
+         int index = path[1].index;
+
+         if (depth == 3) {
+            switch (key) {
+               case KEY_DT:       weather.forecastTime[index]     = value.AsInt();         break;
+               case KEY_RAIN:     weather.forecastRain[index]     = value.AsFloat();       break;
+               case KEY_POP:      weather.forecastPop[index]      = value.AsFloat() * 100; break;
+               case KEY_PRESSURE: weather.forecastPressure[index] = value.AsFloat();       break;
+               default:                                                                    break;
+            }
+         } else if (depth == 4 && path[2].key == KEY_TEMP) {
+            if (key == KEY_MAX) {
+               weather.forecastMaxTemp[index] = value.AsFloat();
+            } else if (key == KEY_MIN) {
+               weather.forecastMinTemp[index] = value.AsFloat();
+            }
+         } else if (depth == 5 && path[2].key == KEY_WEATHER && key == KEY_ICON && value.isString) {
+            CopyText(weather.forecastIcon[index], value.text);
+         }
+         break;
+      }
+      default:
+         break;
+   }
+}
+
+/* Local times and ranges like Fill(), the timezone may come after the times */
+template <typename Reader>
+void WeatherParser<Reader>::Finish()
+{
+   weather.currentTime       = weather.LocalTime(current.time);
+   weather.sunrise           = weather.LocalTime(weather.sunrise);
+   weather.sunset            = weather.LocalTime(weather.sunset);
+   weather.hourlyTime[0]     = weather.currentTime;
+   weather.hourlyMaxTemp[0]  = current.temp;
+   weather.hourlyRain[0]     = current.rain;
+   weather.hourlyPop[0]      = current.pop * 100;
+   weather.hourlyPressure[0] = current.pressure;
+   strcpy(weather.hourlyMain[0], current.main);
+   strcpy(weather.hourlyIcon[0], current.icon);
+   for (int i = 1; i < hourlyCount; i++) {
+      weather.hourlyTime[i] = weather.LocalTime(weather.hourlyTime[i]);
+   }
+   for (int i = 0; i < forecastCount; i++) {
+      weather.forecastTime[i] = weather.LocalTime(weather.forecastTime[i]);
+   }
+   weather.UpdateRanges(hourlyCount);
+}
@@ -0,0 +1,251 @@
+/**
+  * @file HostMain.cpp
+  *
+  * Native host build of the display: renders the screen with a recorded
+  * openweathermap response into a PGM file, times the rendering and
+  * compares the result with a golden image.
+  *
+  *   program [-p] [-f] [-r] [-n count] [-w weather.json] [-o display.pgm] [-g golden.pgm] [-l last.pgm] [-s nvs.bin]
+  *
+  *   -p  render Show() followed by ShowM5PaperInfo() like REFRESH_PARTLY
+  *   -f  draw the background and the indoor panel on a thread during the fetch like setup(),
+  *       the first timed Show() continues with it
+  *   -r  render every region of the layout alone with DrawRegion(), exits with 1 if one
+  *       differs from the display
+  *   -n  number of timed runs of each render function (default 1)
+  *   -w  recorded openweathermap response (default src/host/weather.json)
+  *   -o  output image (default display.pgm)
+  *   -g  golden image, exits with 1 if the output differs
+  *   -l  image on the e-paper before the wake, like the output of the last run
+  *   -s  file of the NVS values, loaded before and saved after the wake,
+  *       the flash files are kept in the same directory
+  *
+  * A sequence of wakes is simulated by passing the output and the NVS file of
+  * one run to the next one.
+  */
+#include <M5EPD.h>
+#include <getopt.h>
+#include "Config.hpp"
+#include "Data.hpp"
+#include "Display.hpp"
+#include "Battery.hpp"
+#include "SHT30.hpp"
+#include "Time.hpp"
+#include "Utils.hpp"
+#include "Weather.hpp"
+#include "IconBlob.hpp"
+
+MyData         myData;            // The collection of the global data
+WeatherDisplay myDisplay(myData); // The global display helper class
+
+/* Run a render function count times, print the fastest and the average run */
+template <typename F>
+void TimeRender(const char *name, int count, F render)
+{
+   unsigned long best  = 0;
+   unsigned long total = 0;
+
+   for (int i = 0; i < count; i++) {
+      unsigned long start = micros();
+
+      render();
+
+      unsigned long duration = micros() - start;
+
+      total += duration;
+      if (i == 0 || duration < best) {
+         best = duration;
+      }
+   }
+   printf("%s: %lu us (average %lu us over %d runs)\n", name, best, total / count, count);
+}
+
+/* Read a binary 8 bit PGM file of the panel size, as written by SavePGM */
+bool LoadPGM(const char *fileName, std::vector<uint8_t> &pixels)
+{
+   FILE *file = fopen(fileName, "rb");
+   int   width, height, maxValue;
+
+   if (!file) {
+      return false;
+   }
+   bool ok = fscanf(file, "P5 %d %d %d", &width, &height, &maxValue) == 3 && fgetc(file) != EOF
+          && width == M5EPD_Driver::WIDTH && height == M5EPD_Driver::HEIGHT && maxValue == 255;
+
+   pixels.resize(width * height);
+   ok = ok && fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+   fclose(file);
+   return ok;
+}
+
+/* Compare the displayed image with a golden image, print the differing area */
+bool CompareGolden(const char *fileName)
+{
+   std::vector<uint8_t> golden;
+   int                  count = 0;
+   int                  x0 = M5EPD_Driver::WIDTH, y0 = M5EPD_Driver::HEIGHT, x1 = -1, y1 = -1;
+
+   if (!LoadPGM(fileName, golden)) {
+      printf("Golden image %s not readable\n", fileName);
+      return false;
+   }
+   for (int y = 0; y < M5EPD_Driver::HEIGHT; y++) {
+      for (int x = 0; x < M5EPD_Driver::WIDTH; x++) {
+         int i = y * M5EPD_Driver::WIDTH + x;
+
+         if (golden[i] != 255 - M5.EPD.panel[i] * 17) {
+            count++;
+            x0 = min(x0, x); y0 = min(y0, y);
+            x1 = max(x1, x); y1 = max(y1, y);
+         }
+      }
+   }
+   if (count > 0) {
+      printf("Differs from %s: %d pixels in %d,%d - %d,%d\n", fileName, count, x0, y0, x1, y1);
+      return false;
+   }
+   printf("Identical to %s\n", fileName);
+   return true;
+}
+
+/* Render every region of the layout alone and compare it with the displayed image */
+bool CompareRegions()
+{
+   bool ok = true;
+
+   for (int i = 0; i < layout960x540.regionCount; i++) {
+      const PanelRect &region = layout960x540.regions[i];
+      M5EPD_Canvas     target(&M5.EPD);
+      int              count = 0;
+
+      myDisplay.DrawRegion(i, target);
+
+      RasterTarget part = CanvasTarget(target);
+
+      for (int y = 0; y < region.h; y++) {
+         for (int x = 0; x < region.w; x++) {
+            count += part.Pixel(x, y) != M5.EPD.panel[(region.y + y) * M5EPD_Driver::WIDTH + region.x + x];
+         }
+      }
+      target.deleteCanvas();
+      if (count > 0) {
+         printf("Region %d (%d,%d %dx%d) differs in %d pixels\n", i, region.x, region.y, region.w, region.h, count);
+         ok = false;
+      }
+   }
+   if (ok) {
+      printf("Regions identical to the display\n");
+   }
+   return ok;
+}
+
+int main(int argc, char **argv)
+{
+   const char *weatherFile = "src/host/weather.json";
+   const char *outputFile  = "display.pgm";
+   const char *goldenFile  = NULL;
+   const char *lastFile    = NULL;
+   const char *nvsFile     = NULL;
+   bool        partly      = false;
+   bool        fetch       = false;
+   bool        regions     = false;
+   int         count       = 1;
+   int         option;
+
+   while ((option = getopt(argc, argv, "pfrn:w:o:g:l:s:")) != -1) {
+      switch (option) {
+         case 'p': partly      = true;                    break;
+         case 'f': fetch       = true;                    break;
+         case 'r': regions     = true;                    break;
+         case 'n': count       = max(1, atoi(optarg));    break;
+         case 'w': weatherFile = optarg;                  break;
+         case 'o': outputFile  = optarg;                  break;
+         case 'g': goldenFile  = optarg;                  break;
+         case 'l': lastFile    = optarg;                  break;
+         case 's': nvsFile     = optarg;                  break;
+         default:
+            fprintf(stderr, "usage: %s [-p] [-f] [-r] [-n count] [-w weather.json] [-o display.pgm] [-g golden.pgm] [-l last.pgm] [-s nvs.bin]\n", argv[0]);
+            return 2;
+      }
+   }
+
+   // the HTTPClient shim answers the request with the recorded response
+   setenv("WEATHER_JSON", weatherFile, 1);
+
+   if (lastFile != NULL) {
+      std::vector<uint8_t> last;
+
+      if (!LoadPGM(lastFile, last)) {
+         printf("Last image %s not readable\n", lastFile);
+         return 2;
+      }
+      for (size_t i = 0; i < last.size(); i++) {
+         M5.EPD.panel[i] = (255 - last[i]) / 17;
+      }
+   }
+   if (nvsFile != NULL) {
+      // the flash files are kept next to the NVS file
+      std::string path(nvsFile);
+      size_t      slash = path.find_last_of('/');
+
+      setenv("HOST_FLASH_DIR", slash != std::string::npos ? path.substr(0, slash).c_str() : ".", 0);
+      nvsHostLoad(nvsFile);
+   }
+   myData.LoadNVS();
+   if (!myData.panels.IsValid()) {
+      M5.EPD.Clear(true);
+   }
+
+   myData.wifiRSSI = WiFi.RSSI();
+   GetBatteryValues(myData);
+   GetSHT30Values(myData);
+
+   std::thread render;
+
+   if (fetch) {
+      render = StartWorker(1, [] { myDisplay.Prepare(); });
+   }
+   unsigned long fetchStart = micros();
+   bool          parsed     = myData.weather.Get();
+
+   printf("Fetch: %lu us\n", micros() - fetchStart);
+
+   if (render.joinable()) {
+      render.join();
+   }
+   if (!parsed) {
+      return 2;
+   }
+   SetRTCDateTime(myData);
+   myData.Dump();
+
+   // every timed run starts with the panels of the wake
+   PanelState panels = myData.panels;
+
+   TimeRender("Show", count, [&] { myData.panels = panels; myDisplay.Show(); });
+   if (partly) {
+      TimeRender("ShowM5PaperInfo", count, [] { myDisplay.ShowM5PaperInfo(); });
+   }
+
+   printf("EPD updates: %d with %ld pixels (GC16 %d, GL16 %d, DU %d, A2 %d)\n", M5.EPD.updateCount / count, M5.EPD.updateArea / count,
+          M5.EPD.modeCount[UPDATE_MODE_GC16] / count, M5.EPD.modeCount[UPDATE_MODE_GL16] / count,
+          M5.EPD.modeCount[UPDATE_MODE_DU] / count, M5.EPD.modeCount[UPDATE_MODE_A2] / count);
+
+   myData.SaveNVS();
+   if (nvsFile != NULL && !nvsHostSave(nvsFile)) {
+      printf("Can not write %s\n", nvsFile);
+      return 2;
+   }
+   if (!M5.EPD.SavePGM(outputFile)) {
+      printf("Can not write %s\n", outputFile);
+      return 2;
+   }
+   printf("Written %s\n", outputFile);
+   if (goldenFile != NULL && !CompareGolden(goldenFile)) {
+      return 1;
+   }
+   if (regions && !CompareRegions()) {
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,480 @@
+/**
+  * @file RenderBench.cpp
+  *
+  * Microbenchmarks of the WeatherDisplay drawing functions on the host.
+  * Every function is timed in isolation with the data of a recorded openweathermap
+  * response and reports the time per call and the primitives it draws.
+  *
+  *   program [-t ms] [-f filter] [-w weather.json] [-j results.json]
+  *
+  *   -t  minimum measuring time of each benchmark in ms (default 200)
+  *   -f  run only the benchmarks whose name contains filter
+  *   -w  recorded openweathermap response (default src/host/weather.json)
+  *   -j  write the results as JSON
+  *
+  * The drawing functions run in two modes: "direct" draws into a 960x540 canvas
+  * with the frame buffer paths, "canvas" uses a 961 pixel wide canvas, where odd
+  * widths make every function take its canvas fallback like before the direct paths.
+  * DrawIcon/64/drawPixel is the icon loop before the icon formats: one drawPixel() per
+  * pixel of a 16 bit image, on the same icon as DrawIcon/64.
+  * The ParseWeather benchmarks parse the recorded response from memory with the
+  * filtered JsonDocument and with the WeatherParser and print the throughput and
+  * the peak heap usage of both.
+  */
+#include <M5EPD.h>
+#include <getopt.h>
+#include <functional>
+#include <fstream>
+#include <set>
+#include "Config.hpp"
+#include "Data.hpp"
+#include "Display.hpp"
+#include "VectorIcons.hpp"
+#include "Battery.hpp"
+#include "SHT30.hpp"
+#include "Time.hpp"
+#include "Utils.hpp"
+#include "Weather.hpp"
+#include "IconBlob.hpp"
+
+MyData myData; // The collection of the global data
+
+/* Frame buffer paths or canvas fallback */
+enum BenchMode
+{
+   MODE_NONE,   //!< The benchmark sets up its own target
+   MODE_DIRECT, //!< Even canvas width, the frame buffer paths are used
+   MODE_CANVAS  //!< Odd canvas width, all drawing goes through the canvas functions
+};
+
+static const char *BENCH_MODE_NAMES[] = { "-", "direct", "canvas" };
+
+/* One benchmark */
+struct Benchmark
+{
+   String                name; //!< Name of the measured function and its parameters
+   BenchMode             mode; //!< Target of the drawing functions
+   std::function<void()> run;  //!< One call of the measured function
+};
+
+/* Result of one benchmark */
+struct BenchResult
+{
+   const Benchmark *bench;      //!< Measured benchmark
+   double           nsPerCall;  //!< Fastest batch in ns per call
+   double           nsAverage;  //!< Average of all batches in ns per call
+   uint64_t         iterations; //!< Calls of one batch
+   RenderStats      stats;      //!< Primitives of one call
+};
+
+volatile int benchSink; // Keeps the results of pure functions alive
+
+/* Reader of a response in memory for deserializeJson() and the WeatherParser */
+struct MemoryReader
+{
+   const std::string &data;     //!< The response
+   size_t             position; //!< Bytes read
+
+   int read()
+   {
+      return position < data.size() ? (uint8_t) data[position++] : -1;
+   }
+
+   size_t readBytes(char *buffer, size_t length)
+   {
+      length = min(length, data.size() - position);
+      memcpy(buffer, data.data() + position, length);
+      position += length;
+      return length;
+   }
+};
+
+/* Throughput and heap usage of the two weather parsers */
+struct ParseInfo
+{
+   size_t bytes;      //!< Size of the response
+   double jsonNs;     //!< Time of ParseJson()
+   size_t jsonPeak;   //!< Peak heap usage of the JsonDocument
+   int    jsonCount;  //!< Allocations of the JsonDocument
+   double saxNs;      //!< Time of ParseSax()
+   size_t saxState;   //!< Size of the WeatherParser on the stack, it allocates nothing
+};
+
+/* Reference of the icon lookup: a String compare against every code, like the if/else chains the table replaced */
+IconId GetWeatherIconByString(const String &code)
+{
+   for (const IconCode &entry : ICON_CODES) {
+      if (code == entry.code) {
+         return entry.icon;
+      }
+   }
+   return ICON_ID_UNKNOWN;
+}
+
+/* Access to the protected drawing functions */
+class BenchDisplay : public WeatherDisplay
+{
+public:
+   BenchDisplay(MyData &md)
+      : WeatherDisplay(md)
+   {
+   }
+
+   /* Create the canvas of a mode with the text settings of Show() */
+   void Prepare(BenchMode mode)
+   {
+      canvas.createCanvas(mode == MODE_CANVAS ? maxX + 1 : maxX, maxY);
+      SetTextSize(3);
+      canvas.setTextColor(WHITE, BLACK);
+      canvas.setTextDatum(TL_DATUM);
+   }
+
+   /* Reference of DrawIcon(): the old loop over a 16 bit image with one drawPixel() per pixel */
+   void DrawIconPixels(int x, int y, const uint16_t *icon, int dx, int dy, bool highContrast = false)
+   {
+      for (int yi = 0; yi < dy; yi++) {
+         for (int xi = 0; xi < dx; xi++) {
+            uint16_t pixel = icon[yi * dx + xi];
+
+            if (highContrast) {
+               if (15 - (pixel / 4096) > 0) canvas.drawPixel(x + xi, y + yi, M5EPD_Canvas::G15);
+            } else {
+               canvas.drawPixel(x + xi, y + yi, 15 - (pixel / 4096));
+            }
+         }
+      }
+   }
+
+   void AddBenchmarks(std::vector<Benchmark> &list);
+};
+
+/* Decode an icon into a 16 bit image like the arrays of the old Icons.hpp, the gray value in the top nibble */
+std::vector<uint16_t> GetIconPixels(IconId id, int size)
+{
+   Icon                  icon = GetIcon(id, size);
+   std::vector<uint16_t> pixels(icon.width * icon.height);
+   const uint8_t        *src  = icon.data;
+
+   for (int y = 0; y < icon.height; y++) {
+      uint16_t *row = &pixels[y * icon.width];
+
+      if (icon.format == ICON_RLE4) {
+         src = ForEachRleRun(src, icon.width, [&](int x, int length, uint8_t gray) {
+            std::fill(row + x, row + x + length, (uint16_t) ((15 - gray) << 12));
+         });
+      } else {
+         for (int x = 0; x < icon.width; x++) {
+            uint8_t gray = x & 1 ? src[x / 2] & 0x0f : src[x / 2] >> 4;
+
+            row[x] = (15 - gray) << 12;
+         }
+         src += icon.width / 2;
+      }
+   }
+   return pixels;
+}
+
+/* All benchmarks, the parameters are the ones of Show() */
+void BenchDisplay::AddBenchmarks(std::vector<Benchmark> &list)
+{
+   static std::vector<uint16_t> pixels = GetIconPixels(ICON_ID_10D, 64);
+   Weather                     &weather = myData.weather;
+
+   for (BenchMode mode : { MODE_DIRECT, MODE_CANVAS }) {
+      list.push_back({ "DrawIcon/64",    mode, [this] { DrawIcon(100, 100, ICON_ID_10D, 64); } });
+      list.push_back({ "DrawIcon/64/hc", mode, [this] { DrawIcon(100, 100, ICON_ID_10D, 64, true); } });
+      list.push_back({ "DrawIcon/64/drawPixel",    mode, [this] { DrawIconPixels(100, 100, pixels.data(), 64, 64); } });
+      list.push_back({ "DrawIcon/64/hc/drawPixel", mode, [this] { DrawIconPixels(100, 100, pixels.data(), 64, 64, true); } });
+      list.push_back({ "DrawIcon/128",   mode, [this] { DrawIcon(100, 100, ICON_ID_10D, 128); } });
+      list.push_back({ "DrawGraph", mode, [this, &weather] {
+         DrawGraph(15, 408, 232, 122, "Temp 12h (C)", 0, 12, weather.hourlyTempRange[0], weather.hourlyTempRange[1], weather.hourlyMaxTemp, NULL);
+      } });
+      list.push_back({ "DrawDualGraph", mode, [this, &weather] {
+         DrawDualGraph(713, 365, 232, 175, "Rain 7days (mm/%)", 0, 7, 0, 100, weather.forecastPop, 0, 0, weather.forecastMaxRain, weather.forecastRain);
+      } });
+      list.push_back({ "DisplayDisplayWindSection", mode, [this, &weather] {
+         DisplayDisplayWindSection(548, 215, weather.winddir, weather.windspeed, 95);
+      } });
+      list.push_back({ "DrawCircle/rssi", mode, [this] { DrawCircle(827, 25, 16, M5EPD_Canvas::G15, 225, 315); } });
+      list.push_back({ "DrawCircle/360",  mode, [this] { DrawCircle(480, 270, 95, M5EPD_Canvas::G15); } });
+      list.push_back({ "DrawHead", mode, [this] { DrawHead(0, 0, 960, 35); } });
+      list.push_back({ "DrawDaily", mode, [this, &weather] { DrawDaily(150, 365, 135, 175, weather, 1); } });
+      list.push_back({ "DrawM5PaperInfo", mode, [this] { DrawM5PaperInfo(691, 35, 269, 320); } });
+   }
+   list.push_back({ "DrawVectorIcon/64", MODE_DIRECT, [this] { DrawVectorIcon(canvas, 100, 100, 64, VEC_ICON_10D); } });
+   list.push_back({ "Show",            MODE_NONE, [this] { myData.panels = PanelState(); Show(); } });
+   list.push_back({ "Show/unchanged",  MODE_NONE, [this] { Show(); } });
+   list.push_back({ "ShowM5PaperInfo", MODE_NONE, [this] {
+      myData.panels.info[INFO_DATE].hash = 0;
+      ShowM5PaperInfo();
+   } });
+   list.push_back({ "ShowM5PaperInfo/time", MODE_NONE, [this] {
+      myData.panels.info[INFO_TIME].hash  = 1;
+      myData.panels.partial[PANEL_INDOOR] = 0;
+      ShowM5PaperInfo();
+   } });
+}
+
+/* Decoding of the icon rows without the canvas, RLE runs against the packed rows of the same image */
+void AddIconBenchmarks(std::vector<Benchmark> &list)
+{
+   static std::vector<uint8_t> frame(64 * 64 / 2);
+   static std::vector<uint8_t> packed(64 * 64 / 2);
+   static RasterTarget         target(frame.data(), 64, 64);
+   Icon                        icon = GetIcon(ICON_ID_10D, 64);
+
+   if (icon.format == ICON_RLE4) {
+      RasterTarget   unpacked(packed.data(), 64, 64);
+      const uint8_t *src = icon.data;
+
+      for (int y = 0; y < icon.height; y++) {
+         src = ForEachRleRun(src, icon.width, [&](int x, int length, uint8_t gray) {
+            FillSpan4(unpacked.Row(y), x, length, gray);
+         });
+      }
+      list.push_back({ "IconRows/rle", MODE_NONE, [icon] {
+         const uint8_t *src = icon.data;
+
+         for (int y = 0; y < icon.height; y++) {
+            src = ForEachRleRun(src, icon.width, [&](int x, int length, uint8_t gray) {
+               FillSpan4(target.Row(y), x, length, gray);
+            });
+         }
+      } });
+   } else {
+      memcpy(packed.data(), icon.data, packed.size());
+   }
+   list.push_back({ "IconRows/packed", MODE_NONE, [] { target.Blit4(0, 0, packed.data(), 64, 64); } });
+
+   list.push_back({ "IconLookup/table", MODE_NONE, [] {
+      for (const IconCode &entry : ICON_CODES) {
+         benchSink = GetWeatherIcon(entry.code);
+      }
+   } });
+   static std::vector<String> codes;
+
+   for (const IconCode &entry : ICON_CODES) {
+      codes.push_back(entry.code);
+   }
+   list.push_back({ "IconLookup/string", MODE_NONE, [] {
+      for (const String &code : codes) {
+         benchSink = GetWeatherIconByString(code);
+      }
+   } });
+}
+
+/* Parse the recorded response from memory with both parsers */
+void AddParseBenchmarks(std::vector<Benchmark> &list, const char *weatherFile)
+{
+   static std::string response;
+   static Weather     weather;
+   std::ifstream      file(weatherFile, std::ios::binary);
+
+   response.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+   list.push_back({ "ParseWeather/json", MODE_NONE, [] {
+      MemoryReader reader = { response, 0 };
+      JsonDocument doc;
+
+      benchSink = weather.ParseJson(reader, doc);
+   } });
+   list.push_back({ "ParseWeather/sax", MODE_NONE, [] {
+      MemoryReader reader = { response, 0 };
+
+      benchSink = weather.ParseSax(reader);
+   } });
+}
+
+/* Heap usage of the parsers, the times are taken from the results of the ParseWeather benchmarks */
+ParseInfo GetParseInfo(const char *weatherFile, const std::vector<BenchResult> &results)
+{
+   std::ifstream     file(weatherFile, std::ios::binary);
+   std::string       response((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+   MemoryReader      reader = { response, 0 };
+   JsonPeakAllocator allocator;
+   ParseInfo         info   = { response.size(), 0, 0, 0, 0, sizeof(WeatherParser<MemoryReader>) };
+   Weather           weather;
+
+   {
+      JsonDocument doc(&allocator);
+
+      weather.ParseJson(reader, doc);
+   }
+   info.jsonPeak  = allocator.Peak();
+   info.jsonCount = allocator.Count();
+   for (const BenchResult &r : results) {
+      if (r.bench->name == "ParseWeather/json") {
+         info.jsonNs = r.nsPerCall;
+      } else if (r.bench->name == "ParseWeather/sax") {
+         info.saxNs = r.nsPerCall;
+      }
+   }
+   return info;
+}
+
+/* Run a benchmark in batches until the minimum time is reached, the fastest batch counts */
+BenchResult RunBenchmark(BenchDisplay &display, const Benchmark &bench, double minTimeNs)
+{
+   typedef std::chrono::steady_clock Clock;
+
+   BenchResult result = { &bench, 0, 0, 1, RenderStats() };
+   double      total  = 0;
+   int         batches = 0;
+
+   if (bench.mode != MODE_NONE) {
+      display.Prepare(bench.mode);
+   }
+   bench.run(); // warm up, builds the glyph atlases
+   renderStats.Reset();
+   bench.run();
+   result.stats = renderStats;
+
+   // grow the batch to a fifth of the minimum time, then measure at least five batches
+   for (;;) {
+      Clock::time_point start = Clock::now();
+
+      for (uint64_t i = 0; i < result.iterations; i++) {
+         bench.run();
+      }
+
+      double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+      if (ns < minTimeNs / 5 && batches == 0) {
+         result.iterations *= 2;
+         continue;
+      }
+      ns /= result.iterations;
+      if (batches == 0 || ns < result.nsPerCall) {
+         result.nsPerCall = ns;
+      }
+      total += ns;
+      if (++batches >= 5) {
+         break;
+      }
+   }
+   result.nsAverage = total / batches;
+   return result;
+}
+
+/* Compression of the icon blob, raw 4bpp bytes of all distinct images against the blob */
+void GetIconBlobInfo(uint32_t &rawBytes, uint32_t &rleImages, uint32_t &packedImages)
+{
+   std::set<uint32_t> offsets;
+
+   rawBytes = rleImages = packedImages = 0;
+   for (int id = 0; id < ICON_ID_COUNT; id++) {
+      for (int size = 0; size < ICON_SIZE_COUNT; size++) {
+         const IconEntry &entry = ICON_INDEX[id][size];
+
+         if (offsets.insert(entry.offset).second) {
+            rawBytes += entry.width * entry.height / 2;
+            (entry.format == ICON_RLE4 ? rleImages : packedImages)++;
+         }
+      }
+   }
+}
+
+/* Write the results as JSON, the primitive counters are per call and only listed if not zero */
+bool WriteJson(const char *fileName, const std::vector<BenchResult> &results, const ParseInfo &parse)
+{
+   FILE    *file = fopen(fileName, "w");
+   uint32_t rawBytes, rleImages, packedImages;
+
+   if (!file) {
+      return false;
+   }
+   GetIconBlobInfo(rawBytes, rleImages, packedImages);
+   fprintf(file, "{\n  \"icons\": { \"raw_bytes\": %u, \"blob_bytes\": %u, \"rle_images\": %u, \"packed_images\": %u },\n",
+           rawBytes, (unsigned) ICON_BLOB_SIZE, rleImages, packedImages);
+   fprintf(file, "  \"parse\": { \"bytes\": %u, \"json_ns\": %.1f, \"json_peak_bytes\": %u, \"json_allocations\": %d, \"sax_ns\": %.1f, \"sax_state_bytes\": %u },\n",
+           (unsigned) parse.bytes, parse.jsonNs, (unsigned) parse.jsonPeak, parse.jsonCount, parse.saxNs, (unsigned) parse.saxState);
+   fprintf(file, "  \"benchmarks\": [\n");
+   for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult &r = results[i];
+      const char        *separator = "";
+
+      fprintf(file, "    { \"name\": \"%s\", \"mode\": \"%s\", \"ns_per_call\": %.1f, \"ns_average\": %.1f, \"iterations\": %llu, \"primitives\": {",
+              r.bench->name.c_str(), BENCH_MODE_NAMES[r.bench->mode], r.nsPerCall, r.nsAverage, (unsigned long long) r.iterations);
+#define RENDER_COUNTER_JSON(name)                                                              \
+      if (r.stats.name != 0) {                                                                 \
+         fprintf(file, "%s \"" #name "\": %llu", separator, (unsigned long long) r.stats.name); \
+         separator = ",";                                                                      \
+      }
+      RENDER_COUNTERS(RENDER_COUNTER_JSON)
+#undef RENDER_COUNTER_JSON
+      fprintf(file, " } }%s\n", i + 1 < results.size() ? "," : "");
+   }
+   fprintf(file, "  ]\n}\n");
+   return fclose(file) == 0;
+}
+
+/* Print one result line with the most telling counters */
+void PrintResult(const BenchResult &r)
+{
+   const RenderStats &s = r.stats;
+
+   printf("%-28s %-7s %12.1f %10llu %10llu %10llu %10llu\n", r.bench->name.c_str(), BENCH_MODE_NAMES[r.bench->mode], r.nsPerCall,
+          (unsigned long long) s.pixels,
+          (unsigned long long) (s.drawPixel + s.drawFastHLine + s.drawFastVLine + s.drawLine + s.drawRect + s.fillRect
+                                + s.drawCircle + s.fillCircle + s.fillTriangle + s.drawString),
+          (unsigned long long) (s.rasterSpans + s.rasterVLines),
+          (unsigned long long) (s.rasterRows + s.rasterMaskRows));
+}
+
+int main(int argc, char **argv)
+{
+   const char *weatherFile = "src/host/weather.json";
+   const char *jsonFile    = NULL;
+   const char *filter      = NULL;
+   double      minTimeMs   = 200;
+   int         option;
+
+   while ((option = getopt(argc, argv, "t:f:w:j:")) != -1) {
+      switch (option) {
+         case 't': minTimeMs   = atof(optarg); break;
+         case 'f': filter      = optarg;       break;
+         case 'w': weatherFile = optarg;       break;
+         case 'j': jsonFile    = optarg;       break;
+         default:
+            fprintf(stderr, "usage: %s [-t ms] [-f filter] [-w weather.json] [-j results.json]\n", argv[0]);
+            return 2;
+      }
+   }
+
+   // same fixed inputs as the host build of the display
+   setenv("WEATHER_JSON", weatherFile, 1);
+   myData.wifiRSSI = WiFi.RSSI();
+   GetBatteryValues(myData);
+   GetSHT30Values(myData);
+   if (!myData.weather.Get()) {
+      return 2;
+   }
+   SetRTCDateTime(myData);
+   Serial.enabled = false;
+
+   BenchDisplay             display(myData);
+   std::vector<Benchmark>   list;
+   std::vector<BenchResult> results;
+
+   display.AddBenchmarks(list);
+   AddIconBenchmarks(list);
+   AddParseBenchmarks(list, weatherFile);
+
+   printf("%-28s %-7s %12s %10s %10s %10s %10s\n", "benchmark", "mode", "ns/call", "pixels", "canvas", "spans", "rows");
+   for (const Benchmark &bench : list) {
+      if (filter == NULL || strstr(bench.name.c_str(), filter) != NULL) {
+         results.push_back(RunBenchmark(display, bench, minTimeMs * 1e6));
+         PrintResult(results.back());
+      }
+   }
+
+   ParseInfo parse = GetParseInfo(weatherFile, results);
+
+   printf("\nParseWeather: %u bytes, json %.1f MB/s with %u bytes peak heap in %d allocations, sax %.1f MB/s without heap, %u bytes state\n",
+          (unsigned) parse.bytes, parse.jsonNs > 0 ? parse.bytes * 1e3 / parse.jsonNs : 0, (unsigned) parse.jsonPeak, parse.jsonCount,
+          parse.saxNs > 0 ? parse.bytes * 1e3 / parse.saxNs : 0, (unsigned) parse.saxState);
+   if (jsonFile != NULL && !WriteJson(jsonFile, results, parse)) {
+      printf("Can not write %s\n", jsonFile);
+      return 2;
+   }
+   return 0;
+}
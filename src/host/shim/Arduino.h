@@ -0,0 +1,119 @@
+/**
+  * @file Arduino.h
+  *
+  * Minimal Arduino core replacement for the native host build.
+  */
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define F(s)        (s)
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+using std::max;
+using std::min;
+
+/* std::string based replacement of the Arduino String class */
+class String
+{
+protected:
+   std::string str;
+
+public:
+   String()                              {}
+   String(const char *s)          : str(s ? s : "") {}
+   String(const std::string &s)   : str(s) {}
+   String(char c)                 : str(1, c) {}
+   String(int value)              : str(std::to_string(value)) {}
+   String(unsigned int value)     : str(std::to_string(value)) {}
+   String(long value)             : str(std::to_string(value)) {}
+   String(unsigned long value)    : str(std::to_string(value)) {}
+   String(long long value)        : str(std::to_string(value)) {}
+   String(float value, unsigned int decimals = 2)  { Format(value, decimals); }
+   String(double value, unsigned int decimals = 2) { Format(value, decimals); }
+
+   const char  *c_str() const                    { return str.c_str(); }
+   unsigned int length() const                   { return str.length(); }
+   long         toInt() const                    { return atol(str.c_str()); }
+   char         operator[](unsigned int i) const { return str[i]; }
+
+   String &operator+=(const String &s)       { str += s.str; return *this; }
+   bool    operator==(const String &s) const { return str == s.str; }
+   bool    operator==(const char *s) const   { return str == s; }
+   bool    operator!=(const String &s) const { return str != s.str; }
+
+   friend String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+   friend String operator+(const char *a, const String &b)   { return String(a + b.str); }
+   friend String operator+(const String &a, const char *b)   { return String(a.str + b); }
+
+protected:
+   void Format(double value, unsigned int decimals)
+   {
+      char buff[48];
+
+      snprintf(buff, sizeof(buff), "%.*f", (int) decimals, value);
+      str = buff;
+   }
+};
+
+/* Serial port replacement writing to stdout, the benchmarks switch it off */
+class HostSerial
+{
+public:
+   bool enabled = true;
+
+public:
+   void begin(unsigned long)        {}
+   void print(const String &s)      { if (enabled) fputs(s.c_str(), stdout); }
+   void println(const String &s)    { if (enabled) { fputs(s.c_str(), stdout); fputc('\n', stdout); } }
+   void println()                   { if (enabled) fputc('\n', stdout); }
+   void printf(const char *fmt, ...)
+   {
+      va_list args;
+
+      if (enabled) {
+         va_start(args, fmt);
+         vprintf(fmt, args);
+         va_end(args);
+      }
+   }
+};
+
+static HostSerial Serial;
+
+static const auto hostStartTime = std::chrono::steady_clock::now();
+
+inline unsigned long millis()
+{
+   return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - hostStartTime).count();
+}
+
+inline unsigned long micros()
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStartTime).count();
+}
+
+inline void delay(unsigned long ms)
+{
+   (void) ms; // no need to wait for a simulated display
+}
+
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+// the core brings the Stream class with the serial ports
+#include <Stream.h>
@@ -0,0 +1,42 @@
+/**
+  * @file HTTPClient.h
+  *
+  * Host replacement of the HTTPClient, answers every request with a recorded
+  * response file (WEATHER_JSON environment variable, default weather.json)
+  * delivered by the WiFiClient.
+  */
+#pragma once
+#include <WiFiClient.h>
+
+#define HTTP_CODE_OK        200
+#define HTTP_CODE_NOT_FOUND 404
+
+class HTTPClient
+{
+protected:
+   WiFiClient *client = NULL;
+
+public:
+   bool begin(WiFiClient &client, const char *, uint16_t, const String &)
+   {
+      this->client = &client;
+      return true;
+   }
+
+   int GET()
+   {
+      const char *fileName = getenv("WEATHER_JSON");
+
+      return client->Open(fileName ? fileName : "weather.json") ? HTTP_CODE_OK : HTTP_CODE_NOT_FOUND;
+   }
+
+   String errorToString(int code)
+   {
+      return code == HTTP_CODE_NOT_FOUND ? "recorded response not found" : "unknown error";
+   }
+
+   /* Content-Length of the response */
+   int         getSize()   { return client->Size(); }
+   WiFiClient &getStream() { return *client; }
+   void        end()       { client->stop(); }
+};
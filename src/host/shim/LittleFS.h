@@ -0,0 +1,155 @@
+/**
+  * @file LittleFS.h
+  *
+  * Host replacement of the LittleFS flash file system. The files are kept in memory,
+  * or in the directory of the HOST_FLASH_DIR environment variable to keep them across runs.
+  */
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> HostFileData;
+
+/* Directory of the flash files, NULL if they are kept in memory */
+inline const char *HostFlashDir()
+{
+   return getenv("HOST_FLASH_DIR");
+}
+
+inline std::map<std::string, HostFileData> &HostFlashFiles()
+{
+   static std::map<std::string, HostFileData> files;
+   return files;
+}
+
+/* Write a file of the flash directory */
+inline bool HostFlashWrite(const std::string &path, const HostFileData &data)
+{
+   FILE *file = fopen((std::string(HostFlashDir()) + path).c_str(), "wb");
+
+   if (!file) {
+      return false;
+   }
+   bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+   return fclose(file) == 0 && ok;
+}
+
+/* Open file, the content is written when the last copy of a file opened for writing is closed */
+class File
+{
+protected:
+   struct Content
+   {
+      std::string  path;
+      HostFileData data;
+      size_t       position = 0;
+      bool         write    = false;
+
+      ~Content()
+      {
+         if (write) {
+            HostFlashFiles()[path] = data;
+            if (HostFlashDir()) {
+               HostFlashWrite(path, data);
+            }
+         }
+      }
+   };
+   std::shared_ptr<Content> content;
+
+public:
+   File()
+   {
+   }
+
+   File(const std::string &path, const HostFileData &data, bool write)
+      : content(new Content)
+   {
+      content->path  = path;
+      content->data  = data;
+      content->write = write;
+   }
+
+   operator bool() const { return content != nullptr; }
+   size_t size() const   { return content->data.size(); }
+   void   close()        { content.reset(); }
+
+   size_t read(uint8_t *buffer, size_t length)
+   {
+      length = std::min(length, content->data.size() - content->position);
+      memcpy(buffer, content->data.data() + content->position, length);
+      content->position += length;
+      return length;
+   }
+
+   size_t write(const uint8_t *buffer, size_t length)
+   {
+      content->data.insert(content->data.end(), buffer, buffer + length);
+      return length;
+   }
+};
+
+class HostLittleFS
+{
+public:
+   bool begin(bool formatOnFail = false) { (void) formatOnFail; return true; }
+   void end()                            {}
+
+   File open(const char *path, const char *mode = "r")
+   {
+      if (mode[0] == 'w') {
+         return File(path, HostFileData(), true);
+      }
+      if (HostFlashDir()) {
+         FILE        *file = fopen((std::string(HostFlashDir()) + path).c_str(), "rb");
+         HostFileData data;
+         uint8_t      buffer[4096];
+         size_t       length;
+
+         if (!file) {
+            return File();
+         }
+         while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + length);
+         }
+         fclose(file);
+         return File(path, data, false);
+      }
+      auto it = HostFlashFiles().find(path);
+
+      return it != HostFlashFiles().end() ? File(path, it->second, false) : File();
+   }
+
+   bool remove(const char *path)
+   {
+      bool found = HostFlashFiles().erase(path) > 0;
+
+      if (HostFlashDir()) {
+         found = ::remove((std::string(HostFlashDir()) + path).c_str()) == 0;
+      }
+      return found;
+   }
+
+   bool rename(const char *from, const char *to)
+   {
+      auto it = HostFlashFiles().find(from);
+
+      if (HostFlashDir()) {
+         return ::rename((std::string(HostFlashDir()) + from).c_str(), (std::string(HostFlashDir()) + to).c_str()) == 0;
+      }
+      if (it == HostFlashFiles().end()) {
+         return false;
+      }
+      HostFlashFiles()[to] = it->second;
+      HostFlashFiles().erase(from);
+      return true;
+   }
+};
+
+inline HostLittleFS LittleFS;
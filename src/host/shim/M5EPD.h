@@ -0,0 +1,487 @@
+/**
+  * @file M5EPD.h
+  *
+  * Host replacement of the M5EPD library: a 4bpp canvas, a simulated
+  * 960x540 panel, the RTC, the SHT30 and the power functions.
+  */
+#pragma once
+#include <Arduino.h>
+#include <vector>
+#include "glcdfont.h"
+#include "RenderStats.h"
+
+#define WHITE    0xFFFF
+#define BLACK    0x0000
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+
+typedef enum
+{
+   UPDATE_MODE_INIT  = 0,
+   UPDATE_MODE_DU    = 1,
+   UPDATE_MODE_GC16  = 2,
+   UPDATE_MODE_GL16  = 3,
+   UPDATE_MODE_GLR16 = 4,
+   UPDATE_MODE_GLD16 = 5,
+   UPDATE_MODE_DU4   = 6,
+   UPDATE_MODE_A2    = 7,
+   UPDATE_MODE_NONE  = 8
+} m5epd_update_mode_t;
+
+typedef struct
+{
+   int8_t hour;
+   int8_t min;
+   int8_t sec;
+} rtc_time_t;
+
+typedef struct
+{
+   int8_t  week;
+   int8_t  mon;
+   int8_t  day;
+   int16_t year;
+} rtc_date_t;
+
+/* Simulated e-paper panel, keeps the displayed image with one byte per pixel */
+class M5EPD_Driver
+{
+public:
+   static const int WIDTH  = 960;
+   static const int HEIGHT = 540;
+
+   std::vector<uint8_t> panel;       //!< Displayed gray values (0 = white, 15 = black)
+   std::vector<uint8_t> gram;        //!< Controller image memory
+   int                  updateCount; //!< Number of UpdateArea/UpdateFull calls
+   long                 updateArea;  //!< Sum of all updated pixels
+   int                  modeCount[UPDATE_MODE_NONE + 1]; //!< Number of updates per update mode
+
+public:
+   M5EPD_Driver()
+      : panel(WIDTH * HEIGHT, 0)
+      , gram(WIDTH * HEIGHT, 0)
+      , updateCount(0)
+      , updateArea(0)
+      , modeCount()
+   {
+   }
+
+   void SetRotation(uint16_t) {}
+
+   void Clear(bool)
+   {
+      std::fill(panel.begin(), panel.end(), 0);
+      std::fill(gram.begin(),  gram.end(),  0);
+   }
+
+   /* Copy a packed 4bpp image (even pixel in the high nibble) into the controller memory */
+   void WritePartGram4bpp(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *data)
+   {
+      int stride = (w + 1) / 2;
+
+      for (int yi = 0; yi < h; yi++) {
+         for (int xi = 0; xi < w; xi++) {
+            uint8_t b = data[yi * stride + xi / 2];
+            uint8_t c = (xi & 1) ? (b & 0x0F) : (b >> 4);
+
+            if (x + xi < WIDTH && y + yi < HEIGHT) {
+               gram[(y + yi) * WIDTH + x + xi] = c;
+            }
+         }
+      }
+   }
+
+   void WriteFullGram4bpp(const uint8_t *data)
+   {
+      WritePartGram4bpp(0, 0, WIDTH, HEIGHT, data);
+   }
+
+   /* Show the image memory, DU and A2 drive the pixels only to black or white */
+   void UpdateArea(uint16_t x, uint16_t y, uint16_t w, uint16_t h, m5epd_update_mode_t mode)
+   {
+      bool blackWhite = mode == UPDATE_MODE_DU || mode == UPDATE_MODE_A2;
+
+      for (int yi = y; yi < y + h && yi < HEIGHT; yi++) {
+         for (int xi = x; xi < x + w && xi < WIDTH; xi++) {
+            uint8_t gray = gram[yi * WIDTH + xi];
+
+            panel[yi * WIDTH + xi] = blackWhite ? (gray >= 8 ? 15 : 0) : gray;
+         }
+      }
+      modeCount[mode]++;
+      updateCount++;
+      updateArea += (long) w * h;
+   }
+
+   void UpdateFull(m5epd_update_mode_t mode)
+   {
+      UpdateArea(0, 0, WIDTH, HEIGHT, mode);
+   }
+
+   /* Write the displayed image as binary 8 bit PGM file */
+   bool SavePGM(const char *fileName) const
+   {
+      FILE *file = fopen(fileName, "wb");
+
+      if (!file) {
+         return false;
+      }
+      fprintf(file, "P5\n%d %d\n255\n", WIDTH, HEIGHT);
+      for (uint8_t c : panel) {
+         fputc(255 - c * 17, file);
+      }
+      fclose(file);
+      return true;
+   }
+};
+
+/* 4bpp canvas with the subset of the TFT_eSPI drawing API used by the project */
+class M5EPD_Canvas
+{
+public:
+   static const uint32_t G0  = 0;  static const uint32_t G1  = 1;  static const uint32_t G2  = 2;  static const uint32_t G3  = 3;
+   static const uint32_t G4  = 4;  static const uint32_t G5  = 5;  static const uint32_t G6  = 6;  static const uint32_t G7  = 7;
+   static const uint32_t G8  = 8;  static const uint32_t G9  = 9;  static const uint32_t G10 = 10; static const uint32_t G11 = 11;
+   static const uint32_t G12 = 12; static const uint32_t G13 = 13; static const uint32_t G14 = 14; static const uint32_t G15 = 15;
+
+protected:
+   M5EPD_Driver        *epd;
+   std::vector<uint8_t> buffer;
+   int32_t              iwidth;
+   int32_t              iheight;
+   uint8_t              textSize;
+   uint32_t             textColor;
+   uint32_t             textBgColor;
+   uint8_t              textDatum;
+
+public:
+   M5EPD_Canvas(M5EPD_Driver *driver)
+      : epd(driver)
+      , iwidth(0)
+      , iheight(0)
+      , textSize(1)
+      , textColor(15)
+      , textBgColor(15)
+      , textDatum(TL_DATUM)
+   {
+   }
+
+   void *createCanvas(uint16_t w, uint16_t h, uint8_t frames = 1)
+   {
+      (void) frames;
+      iwidth  = w;
+      iheight = h;
+      buffer.assign(((w + 1) / 2) * h, 0);
+      return buffer.data();
+   }
+
+   void     deleteCanvas()             { buffer.clear(); buffer.shrink_to_fit(); iwidth = iheight = 0; }
+   void    *frameBuffer(int8_t f = 1)  { (void) f; return buffer.data(); }
+   int16_t  width() const              { return iwidth; }
+   int16_t  height() const             { return iheight; }
+   void     fillCanvas(uint32_t color) { CanvasPrimitive primitive(renderStats.fillCanvas); memset(buffer.data(), (color & 0x0F) * 0x11, buffer.size()); }
+
+   void setTextSize(uint8_t size)                { textSize = size > 0 ? size : 1; }
+   void setTextColor(uint16_t c)                 { textColor = c & 0x0F; textBgColor = c & 0x0F; }
+   void setTextColor(uint16_t c, uint16_t b)     { textColor = c & 0x0F; textBgColor = b & 0x0F; }
+   void setTextDatum(uint8_t datum)              { textDatum = datum; }
+   uint8_t getTextDatum() const                  { return textDatum; }
+
+   void pushCanvas(int32_t x, int32_t y, m5epd_update_mode_t mode)
+   {
+      CanvasPrimitive primitive(renderStats.pushCanvas);
+
+      epd->WritePartGram4bpp(x, y, iwidth, iheight, buffer.data());
+      epd->UpdateArea(x, y, iwidth, iheight, mode);
+   }
+
+   uint16_t readPixel(int32_t x, int32_t y) const
+   {
+      if (x < 0 || y < 0 || x >= iwidth || y >= iheight) {
+         return 0;
+      }
+      uint8_t b = buffer[y * ((iwidth + 1) / 2) + x / 2];
+      return (x & 1) ? (b & 0x0F) : (b >> 4);
+   }
+
+   void drawPixel(int32_t x, int32_t y, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawPixel);
+
+      if (x < 0 || y < 0 || x >= iwidth || y >= iheight) {
+         return;
+      }
+      uint8_t &b = buffer[y * ((iwidth + 1) / 2) + x / 2];
+
+      renderStats.pixels++;
+      color &= 0x0F;
+      b = (x & 1) ? ((b & 0xF0) | color) : ((b & 0x0F) | (color << 4));
+   }
+
+   void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawFastHLine);
+
+      for (int32_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+   }
+
+   void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawFastVLine);
+
+      for (int32_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+   }
+
+   void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawLine);
+
+      bool steep = abs(y1 - y0) > abs(x1 - x0);
+
+      if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
+      if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+
+      int32_t dx   = x1 - x0;
+      int32_t dy   = abs(y1 - y0);
+      int32_t err  = dx >> 1;
+      int32_t step = y0 < y1 ? 1 : -1;
+
+      for (; x0 <= x1; x0++) {
+         if (steep) drawPixel(y0, x0, color); else drawPixel(x0, y0, color);
+         err -= dy;
+         if (err < 0) { y0 += step; err += dx; }
+      }
+   }
+
+   void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawRect);
+
+      drawFastHLine(x, y, w, color);
+      drawFastHLine(x, y + h - 1, w, color);
+      drawFastVLine(x, y, h, color);
+      drawFastVLine(x + w - 1, y, h, color);
+   }
+
+   void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.fillRect);
+
+      for (int32_t i = 0; i < h; i++) drawFastHLine(x, y + i, w, color);
+   }
+
+   void drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.drawCircle);
+
+      int32_t f = 1 - r, ddF_y = -2 * r, ddF_x = 1, xs = -1, xe = 0, len = 0;
+
+      bool first = true;
+      do {
+         while (f < 0) { ++xe; f += (ddF_x += 2); }
+         f += (ddF_y += 2);
+         if (xe - xs > 1) {
+            if (first) {
+               len = 2 * (xe - xs) - 1;
+               drawFastHLine(x0 - xe, y0 + r, len, color);
+               drawFastHLine(x0 - xe, y0 - r, len, color);
+               drawFastVLine(x0 + r, y0 - xe, len, color);
+               drawFastVLine(x0 - r, y0 - xe, len, color);
+               first = false;
+            } else {
+               len = xe - xs++;
+               drawFastHLine(x0 - xe, y0 + r, len, color);
+               drawFastHLine(x0 - xe, y0 - r, len, color);
+               drawFastHLine(x0 + xs, y0 - r, len, color);
+               drawFastHLine(x0 + xs, y0 + r, len, color);
+               drawFastVLine(x0 + r, y0 + xs, len, color);
+               drawFastVLine(x0 + r, y0 - xe, len, color);
+               drawFastVLine(x0 - r, y0 - xe, len, color);
+               drawFastVLine(x0 - r, y0 + xs, len, color);
+            }
+            xs = xe;
+         }
+      } while (xe < --r);
+   }
+
+   void fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.fillCircle);
+
+      int32_t x = 0, dx = 1, dy = r + r, p = -(r >> 1);
+
+      drawFastHLine(x0 - r, y0, dy + 1, color);
+      while (x < r) {
+         if (p >= 0) {
+            drawFastHLine(x0 - x, y0 + r, dx, color);
+            drawFastHLine(x0 - x, y0 - r, dx, color);
+            dy -= 2;
+            p  -= dy;
+            r--;
+         }
+         dx += 2;
+         p  += dx;
+         x++;
+         drawFastHLine(x0 - r, y0 + x, dy + 1, color);
+         drawFastHLine(x0 - r, y0 - x, dy + 1, color);
+      }
+   }
+
+   void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
+   {
+      CanvasPrimitive primitive(renderStats.fillTriangle);
+
+      if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+      if (y1 > y2) { std::swap(y2, y1); std::swap(x2, x1); }
+      if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+
+      if (y0 == y2) {
+         int32_t a = std::min(x0, std::min(x1, x2));
+         int32_t b = std::max(x0, std::max(x1, x2));
+         drawFastHLine(a, y0, b - a + 1, color);
+         return;
+      }
+
+      int32_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+      int32_t sa = 0, sb = 0, a, b, y, last = (y1 == y2) ? y1 : y1 - 1;
+
+      for (y = y0; y <= last; y++) {
+         a   = x0 + sa / dy01;
+         b   = x0 + sb / dy02;
+         sa += dx01;
+         sb += dx02;
+         if (a > b) std::swap(a, b);
+         drawFastHLine(a, y, b - a + 1, color);
+      }
+      sa = dx12 * (y - y1);
+      sb = dx02 * (y - y0);
+      for (; y <= y2; y++) {
+         a   = x1 + sa / dy12;
+         b   = x0 + sb / dy02;
+         sa += dx12;
+         sb += dx02;
+         if (a > b) std::swap(a, b);
+         drawFastHLine(a, y, b - a + 1, color);
+      }
+   }
+
+   void drawChar(int32_t x, int32_t y, char c, uint32_t color, uint32_t bg, uint8_t size)
+   {
+      if (c < 0x20 || c > 0x7e) {
+         c = '?';
+      }
+      const uint8_t *glyph = glcdFont[c - 0x20];
+
+      for (int col = 0; col < 6; col++) {
+         uint8_t line = col < 5 ? glyph[col] : 0;
+
+         for (int row = 0; row < 8; row++, line >>= 1) {
+            if (line & 1) {
+               fillRect(x + col * size, y + row * size, size, size, color);
+            } else if (bg != color) {
+               fillRect(x + col * size, y + row * size, size, size, bg);
+            }
+         }
+      }
+   }
+
+   int16_t textWidth(const String &string, uint8_t font = 1) const
+   {
+      (void) font;
+      return string.length() * 6 * textSize;
+   }
+
+   int16_t drawString(const String &string, int32_t x, int32_t y, uint8_t font = 1)
+   {
+      CanvasPrimitive primitive(renderStats.drawString);
+
+      int16_t width = textWidth(string, font);
+
+      if (textDatum == TC_DATUM) x -= width / 2;
+      if (textDatum == TR_DATUM) x -= width;
+      for (unsigned int i = 0; i < string.length(); i++) {
+         drawChar(x + i * 6 * textSize, y, string[i], textColor, textBgColor, textSize);
+      }
+      return width;
+   }
+
+   int16_t drawCentreString(const String &string, int32_t x, int32_t y, uint8_t font = 1)
+   {
+      CanvasPrimitive primitive(renderStats.drawString);
+
+      uint8_t datum = textDatum;
+      textDatum = TC_DATUM;
+      int16_t width = drawString(string, x, y, font);
+      textDatum = datum;
+      return width;
+   }
+
+   int16_t drawRightString(const String &string, int32_t x, int32_t y, uint8_t font = 1)
+   {
+      CanvasPrimitive primitive(renderStats.drawString);
+
+      uint8_t datum = textDatum;
+      textDatum = TR_DATUM;
+      int16_t width = drawString(string, x, y, font);
+      textDatum = datum;
+      return width;
+   }
+};
+
+/* Host RTC, starts at a fixed date to keep the rendered images reproducible and can be set like the BM8563 */
+class HostRTC
+{
+public:
+   rtc_date_t date = { 6, 1, 1, 2000 };
+   rtc_time_t time = { 0, 0, 0 };
+
+public:
+   void begin()                        {}
+   void getDate(rtc_date_t *d)         { *d = date; }
+   void getTime(rtc_time_t *t)         { *t = time; }
+   void setDate(const rtc_date_t *d)   { date = *d; }
+   void setTime(const rtc_time_t *t)   { time = *t; }
+};
+
+/* Host SHT30 with fixed values */
+class HostSHT30
+{
+public:
+   float temperature = 23.0f;
+   float humidity    = 45.0f;
+
+public:
+   void    UpdateData()           {}
+   uint8_t GetError()             { return 0; }
+   float   GetTemperature()       { return temperature; }
+   float   GetRelHumidity()       { return humidity; }
+};
+
+class HostGT911
+{
+public:
+   void SetRotation(uint16_t) {}
+};
+
+/* Host replacement of the M5EPD main class */
+class M5EPD
+{
+public:
+   M5EPD_Driver EPD;
+   HostRTC      RTC;
+   HostSHT30    SHT30;
+   HostGT911    TP;
+   uint32_t     batteryVoltage = 4000;
+
+public:
+   void     begin(bool = true, bool = true, bool = true, bool = true, bool = false) {}
+   uint32_t getBatteryVoltage()  { return batteryVoltage; }
+   void     disableEPDPower()    {}
+   void     disableEXTPower()    {}
+   void     disableMainPower()   {}
+   void     shutdown(int)        {}
+};
+
+inline M5EPD M5; // Global instance like in the M5EPD library
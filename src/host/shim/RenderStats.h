@@ -0,0 +1,65 @@
+/**
+  * @file RenderStats.h
+  *
+  * Primitive counters of the host build, read by the render benchmarks.
+  * The canvas counts the drawing calls, RasterTarget.hpp the frame buffer kernels.
+  */
+#pragma once
+#include <stdint.h>
+
+/* All counters, X(name) */
+#define RENDER_COUNTERS(X) \
+   X(pixels)               \
+   X(drawPixel)            \
+   X(drawFastHLine)        \
+   X(drawFastVLine)        \
+   X(drawLine)             \
+   X(drawRect)             \
+   X(fillRect)             \
+   X(drawCircle)           \
+   X(fillCircle)           \
+   X(fillTriangle)         \
+   X(drawString)           \
+   X(fillCanvas)           \
+   X(pushCanvas)           \
+   X(rasterSpans)          \
+   X(rasterRows)           \
+   X(rasterMaskRows)       \
+   X(rasterVLines)
+
+/* Number of primitives drawn since the last Reset() */
+struct RenderStats
+{
+#define RENDER_COUNTER_FIELD(name) uint64_t name = 0;
+   RENDER_COUNTERS(RENDER_COUNTER_FIELD)
+#undef RENDER_COUNTER_FIELD
+
+   int depth = 0; //!< Nesting of the canvas calls, only the outermost call is counted
+
+   void Reset()
+   {
+      *this = RenderStats();
+   }
+};
+
+// every thread counts its own primitives, the parallel rendering counts only the regions of the calling thread
+inline thread_local RenderStats renderStats;
+
+/* Count one canvas call unless it is made by another canvas call, like drawFastHLine by fillRect */
+class CanvasPrimitive
+{
+public:
+   CanvasPrimitive(uint64_t &counter)
+   {
+      if (renderStats.depth++ == 0) {
+         counter++;
+      }
+   }
+
+   ~CanvasPrimitive()
+   {
+      renderStats.depth--;
+   }
+};
+
+#define RASTER_STAT(counter) (renderStats.counter++)
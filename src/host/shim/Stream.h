@@ -0,0 +1,54 @@
+/**
+  * @file Stream.h
+  *
+  * Host replacement of the Arduino Stream class. read() of a network client returns -1 at once if
+  * no byte has arrived, only readBytes() waits for the bytes up to the timeout like the Arduino core.
+  * With ARDUINOJSON_ENABLE_ARDUINO_STREAM deserializeJson() reads a Stream with readBytes() as on the ESP32.
+  */
+#pragma once
+#include <Arduino.h>
+
+#define STREAM_TIMEOUT 1000 //!< Default timeout of the timed reads in ms
+
+class Stream
+{
+protected:
+   unsigned long timeout = STREAM_TIMEOUT; //!< ms readBytes() waits for the next byte
+
+public:
+   virtual ~Stream() {}
+
+   virtual int available() = 0;
+   virtual int read()      = 0;
+
+   void setTimeout(unsigned long ms)
+   {
+      timeout = ms;
+   }
+
+   /* Read length bytes, returns less if no byte arrives for the timeout */
+   size_t readBytes(char *buffer, size_t length)
+   {
+      size_t        count = 0;
+      unsigned long last  = millis();
+
+      while (count < length) {
+         int c = read();
+
+         if (c >= 0) {
+            buffer[count++] = (char) c;
+            last            = millis();
+         } else if (millis() - last >= timeout) {
+            break;
+         } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      }
+      return count;
+   }
+
+   size_t readBytes(uint8_t *buffer, size_t length)
+   {
+      return readBytes((char *) buffer, length);
+   }
+};
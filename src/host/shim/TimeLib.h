@@ -0,0 +1,80 @@
+/**
+  * @file TimeLib.h
+  *
+  * Host replacement of the Time library, based on the UTC functions of the C library. The date
+  * functions and dayShortStr() share static data like the original, so they are not reentrant.
+  */
+#pragma once
+#include <time.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct
+{
+   uint8_t Second;
+   uint8_t Minute;
+   uint8_t Hour;
+   uint8_t Wday;
+   uint8_t Day;
+   uint8_t Month;
+   uint8_t Year;   // offset from 1970
+} tmElements_t;
+
+/* Break the time into the elements, reentrant */
+inline void breakTime(time_t t, tmElements_t &tm)
+{
+   struct tm parts;
+
+   gmtime_r(&t, &parts);
+   tm.Second = parts.tm_sec;
+   tm.Minute = parts.tm_min;
+   tm.Hour   = parts.tm_hour;
+   tm.Wday   = parts.tm_wday + 1;
+   tm.Day    = parts.tm_mday;
+   tm.Month  = parts.tm_mon + 1;
+   tm.Year   = parts.tm_year - 70;
+}
+
+/* Like the Time library, the date functions share one static cache of the last time */
+inline const tmElements_t &hostTimeCache(time_t t)
+{
+   static tmElements_t cache;
+   static time_t       cacheTime = -1;
+
+   if (t != cacheTime) {
+      breakTime(t, cache);
+      cacheTime = t;
+   }
+   return cache;
+}
+
+inline int year(time_t t)    { return hostTimeCache(t).Year + 1970; }
+inline int month(time_t t)   { return hostTimeCache(t).Month; }
+inline int day(time_t t)     { return hostTimeCache(t).Day; }
+inline int hour(time_t t)    { return hostTimeCache(t).Hour; }
+inline int minute(time_t t)  { return hostTimeCache(t).Minute; }
+inline int second(time_t t)  { return hostTimeCache(t).Second; }
+inline int weekday(time_t t) { return hostTimeCache(t).Wday; }
+
+/* Like the Time library, the name is copied into one static buffer */
+inline const char *dayShortStr(uint8_t day)
+{
+   static const char *names[] = { "Err", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+   static char        buffer[4];
+
+   strcpy(buffer, names[day < 8 ? day : 0]);
+   return buffer;
+}
+
+inline time_t makeTime(const tmElements_t &tm)
+{
+   struct tm t = {};
+
+   t.tm_year = tm.Year + 70;
+   t.tm_mon  = tm.Month - 1;
+   t.tm_mday = tm.Day;
+   t.tm_hour = tm.Hour;
+   t.tm_min  = tm.Minute;
+   t.tm_sec  = tm.Second;
+   return timegm(&t);
+}
@@ -0,0 +1,39 @@
+/**
+  * @file WiFi.h
+  *
+  * Host replacement of the ESP32 WiFi class, always connected.
+  */
+#pragma once
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+#define WIFI_STA     1
+#define WIFI_OFF     0
+
+class IPAddress
+{
+public:
+   uint8_t a, b, c, d;
+
+public:
+   IPAddress(uint8_t a = 127, uint8_t b = 0, uint8_t c = 0, uint8_t d = 1) : a(a), b(b), c(c), d(d) {}
+   String toString() const { return String(a) + "." + String(b) + "." + String(c) + "." + String(d); }
+};
+
+class HostWiFi
+{
+public:
+   int rssi = -60;
+
+public:
+   void      mode(int)                      {}
+   void      disconnect()                   {}
+   void      setAutoConnect(bool)           {}
+   void      setAutoReconnect(bool)         {}
+   void      begin(const char *, const char *) {}
+   int       status()                       { return WL_CONNECTED; }
+   int       RSSI()                         { return rssi; }
+   IPAddress localIP()                      { return IPAddress(); }
+};
+
+static HostWiFi WiFi;
@@ -0,0 +1,106 @@
+/**
+  * @file WiFiClient.h
+  *
+  * Host replacement of the WiFiClient, delivers the recorded response opened by the HTTPClient.
+  * WEATHER_BANDWIDTH (bytes per second) and WEATHER_LATENCY (ms until the first byte) throttle
+  * the delivery like a slow connection, the bytes arrive in packets of WIFI_PACKET_SIZE.
+  * Like the ESP32 client the reads return only the bytes received so far, readBytes() of the
+  * Stream waits for more.
+  */
+#pragma once
+#include <WiFi.h>
+#include <Stream.h>
+#include <fstream>
+
+#define WIFI_PACKET_SIZE 1436 //!< TCP payload of a WLAN frame
+
+class WiFiClient : public Stream
+{
+protected:
+   std::ifstream file;      //!< Recorded response
+   long          size;      //!< Size of the response
+   long          sent;      //!< Bytes returned by the reads
+   long          bandwidth; //!< Bytes per second, 0 without throttling
+   long          latency;   //!< ms until the first packet arrives
+   unsigned long start;     //!< millis() of the request
+
+public:
+   WiFiClient()
+      : size(0)
+      , sent(0)
+      , bandwidth(0)
+      , latency(0)
+      , start(0)
+   {
+   }
+
+   /* Host only: answer the request with a recorded response */
+   bool Open(const char *fileName)
+   {
+      const char *bandwidthValue = getenv("WEATHER_BANDWIDTH");
+      const char *latencyValue   = getenv("WEATHER_LATENCY");
+
+      stop();
+      file.open(fileName, std::ios::binary | std::ios::ate);
+      if (!file.is_open()) {
+         return false;
+      }
+      size      = file.tellg();
+      sent      = 0;
+      bandwidth = bandwidthValue ? atol(bandwidthValue) : 0;
+      latency   = latencyValue ? atol(latencyValue) : 0;
+      start     = millis();
+      file.seekg(0);
+      return true;
+   }
+
+   long Size() const
+   {
+      return size;
+   }
+
+   /* Bytes received and not read yet */
+   int available() override
+   {
+      long arrived = size;
+
+      if (bandwidth > 0 || latency > 0) {
+         long elapsed = (long) (millis() - start) - latency;
+
+         arrived = elapsed < 0 ? 0 : bandwidth > 0 ? min(size, elapsed * bandwidth / 1000 / WIFI_PACKET_SIZE * WIFI_PACKET_SIZE) : size;
+      }
+      return max(arrived - sent, 0L);
+   }
+
+   bool connected()
+   {
+      return file.is_open() && sent < size;
+   }
+
+   /* Read the received bytes without waiting, -1 if there are none */
+   int read(uint8_t *buffer, size_t length)
+   {
+      long count = min((long) length, (long) available());
+
+      if (count <= 0) {
+         return -1;
+      }
+      file.read((char *) buffer, count);
+      sent += count;
+      return count;
+   }
+
+   /* Read one received byte without waiting, -1 if there is none */
+   int read() override
+   {
+      uint8_t c;
+
+      return read(&c, 1) == 1 ? c : -1;
+   }
+
+   void stop()
+   {
+      file.close();
+      size = sent = 0;
+   }
+};
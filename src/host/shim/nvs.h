@@ -0,0 +1,113 @@
+/**
+  * @file nvs.h
+  *
+  * Host replacement of the ESP32 NVS, keeps the values in memory and
+  * optionally in a file of the host program.
+  */
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef uint32_t nvs_handle;
+typedef int      esp_err_t;
+
+typedef enum
+{
+   NVS_READONLY,
+   NVS_READWRITE
+} nvs_open_mode;
+
+#define ESP_OK                 0
+#define ESP_ERR_NVS_NOT_FOUND  0x1102
+
+inline std::map<std::string, std::vector<uint8_t>> &nvsHostStore()
+{
+   static std::map<std::string, std::vector<uint8_t>> store;
+   return store;
+}
+
+inline esp_err_t nvs_open(const char *, nvs_open_mode, nvs_handle *handle) { *handle = 1; return ESP_OK; }
+inline esp_err_t nvs_commit(nvs_handle)                                     { return ESP_OK; }
+inline void      nvs_close(nvs_handle)                                      {}
+
+inline esp_err_t nvs_set_blob(nvs_handle, const char *key, const void *value, size_t length)
+{
+   nvsHostStore()[key].assign((const uint8_t *) value, (const uint8_t *) value + length);
+   return ESP_OK;
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle, const char *key, void *value, size_t *length)
+{
+   auto it = nvsHostStore().find(key);
+
+   if (it == nvsHostStore().end()) {
+      return ESP_ERR_NVS_NOT_FOUND;
+   }
+   if (value) {
+      memcpy(value, it->second.data(), std::min(*length, it->second.size()));
+   }
+   *length = it->second.size();
+   return ESP_OK;
+}
+
+inline esp_err_t nvs_set_u16(nvs_handle handle, const char *key, uint16_t value)
+{
+   return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+inline esp_err_t nvs_get_u16(nvs_handle handle, const char *key, uint16_t *value)
+{
+   size_t length = sizeof(*value);
+   return nvs_get_blob(handle, key, value, &length);
+}
+
+/* Load the values from a file of the host program, to keep them across runs like the flash */
+inline bool nvsHostLoad(const char *fileName)
+{
+   FILE    *file = fopen(fileName, "rb");
+   uint8_t  keyLength;
+   uint32_t length;
+
+   if (!file) {
+      return false;
+   }
+   while (fread(&keyLength, 1, 1, file) == 1) {
+      std::string          key(keyLength, '\0');
+      std::vector<uint8_t> value;
+
+      if (fread(&key[0], 1, keyLength, file) != keyLength || fread(&length, sizeof(length), 1, file) != 1) {
+         break;
+      }
+      value.resize(length);
+      if (fread(value.data(), 1, length, file) != length) {
+         break;
+      }
+      nvsHostStore()[key] = value;
+   }
+   fclose(file);
+   return true;
+}
+
+/* Save all values into a file */
+inline bool nvsHostSave(const char *fileName)
+{
+   FILE *file = fopen(fileName, "wb");
+
+   if (!file) {
+      return false;
+   }
+   for (const auto &entry : nvsHostStore()) {
+      uint8_t  keyLength = entry.first.size();
+      uint32_t length    = entry.second.size();
+
+      fwrite(&keyLength, 1, 1, file);
+      fwrite(entry.first.data(), 1, keyLength, file);
+      fwrite(&length, sizeof(length), 1, file);
+      fwrite(entry.second.data(), 1, length, file);
+   }
+   return fclose(file) == 0;
+}
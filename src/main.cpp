@@ -22,37 +22,46 @@
 MyData         myData;            // The collection of the global data
 WeatherDisplay myDisplay(myData); // The global display helper class
 
-/* Start and M5Paper instance */
-void setup()
+/**
+  * Fetch the weather data and show it. The background and the indoor panel need no network data,
+  * they are drawn on the other core while the wifi connects and the data is downloaded.
+  */
+void ShowWeather()
 {
-#ifndef REFRESH_PARTLY
-   InitEPD(true);
-   if (StartWiFi(myData.wifiRSSI)) {
-      GetBatteryValues(myData);
-      GetSHT30Values(myData);
-      if (myData.weather.Get()) {
-         SetRTCDateTime(myData);
-      }
+   GetBatteryValues(myData);
+   GetSHT30Values(myData);
+
+   std::thread render = StartWorker(1, [] { myDisplay.Prepare(); });
+   bool        online = StartWiFi(myData.wifiRSSI);
+   bool        parsed = online && myData.weather.Get();
+
+   // the RTC is set after the drawing of the indoor panel, Show() redraws it if the time changed
+   render.join();
+   if (parsed) {
+      SetRTCDateTime(myData);
+   }
+   if (online) {
       myData.Dump();
       myDisplay.Show();
       StopWiFi();
    }
+}
+
+/* Start and M5Paper instance */
+void setup()
+{
+#ifndef REFRESH_PARTLY
+   myData.LoadNVS();
+   InitEPD(!myData.panels.IsValid()); // keep the panels on the e-paper for the partial updates
+   ShowWeather();
+   myData.SaveNVS();
    ShutdownEPD(60 * 60); // every 1 hour
    //SleepEPD(3600);  // every 60 min
 #else 
    myData.LoadNVS();
    if (myData.nvsCounter == 1) {
-      InitEPD(true);
-      if (StartWiFi(myData.wifiRSSI)) {
-         GetBatteryValues(myData);
-         GetSHT30Values(myData);
-         if (myData.weather.Get()) {
-            SetRTCDateTime(myData);
-         }
-         myData.Dump();
-         myDisplay.Show();
-         StopWiFi();
-      }
+      InitEPD(!myData.panels.IsValid());
+      ShowWeather();
    } else {
       InitEPD(false);
       GetSHT30Values(myData);
@@ -0,0 +1,305 @@
+"""
+Icon asset pipeline.
+
+Converts the source images in icons/ (binary 8 bit PGM, white background)
+into the native 4bpp icon formats of IconFormat.hpp in all ICON_SIZES,
+adds 1 bit high contrast masks for the weather icons, stores identical
+bitmaps only once and writes
+
+   generated/icons.bin      the icon blob, embedded into the firmware
+   generated/IconIndex.hpp  the icon ids and their position in the blob
+   generated/IconBlob.hpp   the blob as array for the native host build
+
+Runs as PlatformIO pre script and can be started by hand:
+   python tools/icons.py [project dir]
+"""
+import os
+import re
+import sys
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+ICON_DIR   = os.path.join(PROJECT_DIR, "icons")
+SOURCE_DIR = os.path.join(PROJECT_DIR, "src")
+ICON_MAP   = os.path.join(SOURCE_DIR, "IconMap.hpp")
+OUTPUT_DIR = os.path.join(PROJECT_DIR, "generated")
+BLOB_FILE  = os.path.join(OUTPUT_DIR, "icons.bin")
+INDEX_FILE = os.path.join(OUTPUT_DIR, "IconIndex.hpp")
+ARRAY_FILE = os.path.join(OUTPUT_DIR, "IconBlob.hpp")
+
+# Generated sizes, the firmware picks the best one and never scales at runtime
+ICON_SIZES = [32, 48, 64, 128]
+
+# Icons drawn in high contrast mode get a 1 bit mask: the weather icons (like 10d) and the unknown icon
+MASK_ICONS = re.compile(r"^(\d\d[dn]|unknown)$")
+
+# Entry of ICON_CODES in IconMap.hpp like { "01n", ICON_ID_03N } and any icon id used in the sources
+ICON_CODE = re.compile(r'\{\s*"(\w+)"\s*,\s*(ICON_ID_\w+)\s*\}')
+ICON_USE  = re.compile(r"\bICON_ID_\w+")
+
+# IconFormat values of IconFormat.hpp
+ICON_PACKED4 = "ICON_PACKED4"
+ICON_RLE4    = "ICON_RLE4"
+
+
+def read_pgm(file_name):
+    """Read a binary PGM file, returns width, height and the 8 bit pixels."""
+    with open(file_name, "rb") as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b"P5" or int(fields[3]) != 255:
+        raise ValueError("%s: only binary 8 bit PGM files are supported" % file_name)
+    width, height = int(fields[1]), int(fields[2])
+    pixels = data[pos + 1:pos + 1 + width * height]
+    if width % 2 or len(pixels) != width * height:
+        raise ValueError("%s: width must be even and the file complete" % file_name)
+    return width, height, pixels
+
+
+def resample_line(values, count):
+    """Resample a list of gray values: area average for shrinking, linear interpolation for growing."""
+    size = len(values)
+    if count == size:
+        return list(values)
+    out = []
+    if count < size:
+        scale = size / count
+        for i in range(count):
+            start, end = i * scale, (i + 1) * scale
+            total = 0.0
+            j = int(start)
+            while j < end and j < size:
+                total += values[j] * (min(end, j + 1) - max(start, j))
+                j += 1
+            out.append(total / scale)
+    else:
+        scale = size / count
+        for i in range(count):
+            pos = max(0.0, min(size - 1.0, (i + 0.5) * scale - 0.5))
+            j = min(int(pos), size - 2)
+            frac = pos - j
+            out.append(values[j] * (1 - frac) + values[j + 1] * frac)
+    return out
+
+
+def resize(width, height, pixels, new_width, new_height):
+    """Resize 8 bit gray pixels, rows first and then columns."""
+    rows = [resample_line(pixels[y * width:(y + 1) * width], new_width) for y in range(height)]
+    cols = [resample_line([rows[y][x] for y in range(height)], new_height) for x in range(new_width)]
+    return bytes(int(round(cols[x][y])) for y in range(new_height) for x in range(new_width))
+
+
+def scaled_size(width, height, size):
+    """Size of the variant whose larger side is size, the width is kept even."""
+    scale = size / max(width, height)
+    new_width = max(2, int(round(width * scale / 2)) * 2)
+    return new_width, max(1, int(round(height * scale)))
+
+
+def to_gray4(pixels):
+    """Convert 8 bit image pixels (255 = white) to display gray values (0 = white, 15 = black)."""
+    return bytes(15 - (p >> 4) for p in pixels)
+
+
+def encode_packed4(width, height, gray):
+    """Two pixels per byte, left pixel in the high nibble."""
+    return bytes(gray[i] << 4 | gray[i + 1] for i in range(0, width * height, 2))
+
+
+def encode_rle4(width, height, gray):
+    """One byte per run: gray value in the high nibble, length - 1 in the low nibble, runs never cross rows."""
+    out = bytearray()
+    for y in range(height):
+        row = gray[y * width:(y + 1) * width]
+        x = 0
+        while x < width:
+            length = 1
+            while x + length < width and length < 16 and row[x + length] == row[x]:
+                length += 1
+            out.append(row[x] << 4 | (length - 1))
+            x += length
+    return bytes(out)
+
+
+def encode(width, height, gray):
+    """Use the smaller of the two native formats."""
+    packed = encode_packed4(width, height, gray)
+    rle    = encode_rle4(width, height, gray)
+    return (ICON_RLE4, rle) if len(rle) < len(packed) else (ICON_PACKED4, packed)
+
+
+def encode_mask1(width, height, gray):
+    """One bit per pixel, set for every non white pixel, leftmost pixel in the high bit."""
+    out = bytearray()
+    for i in range(0, width * height, 8):
+        bits = 0
+        for g in gray[i:i + 8]:
+            bits = bits << 1 | (g != 0)
+        out.append(bits)
+    return bytes(out)
+
+
+def icon_id(name):
+    return "ICON_ID_" + name.upper().replace("-", "_")
+
+
+def read_aliases():
+    """Codes that ICON_CODES shows with the icon of another code, returns {id: id of the displayed icon}."""
+    with open(ICON_MAP) as f:
+        codes = ICON_CODE.findall(f.read())
+    return {icon_id(code): icon for code, icon in codes if icon_id(code) != icon}
+
+
+def read_used_ids():
+    """All icon ids the firmware sources refer to, images without a reference are not converted."""
+    used = set()
+    for root, dirs, files in os.walk(SOURCE_DIR):
+        for file_name in files:
+            if os.path.splitext(file_name)[1] in (".h", ".hpp", ".c", ".cpp"):
+                with open(os.path.join(root, file_name)) as f:
+                    used.update(ICON_USE.findall(f.read()))
+    return used
+
+
+def build_icons(used, aliases):
+    """Convert the used icons in all sizes, returns the blob and the index entries."""
+    blob    = bytearray()
+    stored  = {}  # (width, height, format, data) -> offset
+    entries = []  # (name, [(width, height, format, offset, mask offset) per size])
+
+    def store(key, data):
+        if key not in stored:
+            stored[key] = len(blob)
+            blob.extend(data)
+        return stored[key]
+
+    for file_name in sorted(os.listdir(ICON_DIR)):
+        name, ext = os.path.splitext(file_name)
+        if ext.lower() != ".pgm" or icon_id(name) not in used or icon_id(name) in aliases:
+            continue
+        width, height, pixels = read_pgm(os.path.join(ICON_DIR, file_name))
+        variants = []
+        for size in ICON_SIZES:
+            new_width, new_height = scaled_size(width, height, size)
+            scaled = resize(width, height, pixels, new_width, new_height)
+            gray = to_gray4(scaled)
+            fmt, data = encode(new_width, new_height, gray)
+            offset = store((new_width, new_height, fmt, data), data)
+            mask = None
+            if MASK_ICONS.match(name) and new_width % 8 == 0:
+                data = encode_mask1(new_width, new_height, gray)
+                mask = store((new_width, new_height, "mask", data), data)
+            variants.append((new_width, new_height, fmt, offset, mask))
+        entries.append((name, variants))
+    return bytes(blob), entries
+
+
+def write_index(blob, entries, aliases):
+    lines = [
+        "/**",
+        "  * @file IconIndex.h",
+        "  *",
+        "  * Generated by tools/icons.py from the images in icons/, do not edit.",
+        "  * Included by IconFormat.hpp.",
+        "  */",
+        "#pragma once",
+        "",
+        "/* All icons of the icon blob */",
+        "enum IconId : uint8_t",
+        "{",
+    ]
+    lines += ["   %s," % icon_id(e[0]) for e in entries]
+    lines.append("   ICON_ID_COUNT%s" % ("," if aliases else ""))
+    if aliases:
+        lines.append("")
+        lines.append("   // Codes shown with the icon of another code, see ICON_CODES in IconMap.hpp")
+        lines += ["   %s = %s," % alias for alias in sorted(aliases.items())]
+    lines += [
+        "};",
+        "",
+        "#define ICON_SIZE_COUNT %d" % len(ICON_SIZES),
+        "",
+        "/* Generated sizes of every icon, ascending */",
+        "static constexpr uint8_t ICON_SIZES[ICON_SIZE_COUNT] = { %s };" % ", ".join(str(size) for size in ICON_SIZES),
+        "",
+        "/* Size and position of every icon size in the icon blob, identical bitmaps share their data */",
+        "static constexpr IconEntry ICON_INDEX[ICON_ID_COUNT][ICON_SIZE_COUNT] = {",
+    ]
+    for name, variants in entries:
+        lines.append("   { // %s" % name)
+        lines += ["      { %3d, %3d, %-13s %6d, %12s }," % (w, h, fmt + ",", offset, "ICON_NO_MASK" if mask is None else mask)
+                  for w, h, fmt, offset, mask in variants]
+        lines.append("   },")
+    lines += [
+        "};",
+        "",
+        "#define ICON_BLOB_SIZE %d" % len(blob),
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def write_array(blob):
+    """The host build can not embed binary files, it includes the blob as array under the embedded symbol name."""
+    lines = [
+        "/**",
+        "  * @file IconBlob.h",
+        "  *",
+        "  * Generated by tools/icons.py from the images in icons/, do not edit.",
+        "  * The icon blob for the native host build, include it in exactly one source file.",
+        "  */",
+        "#pragma once",
+        "#include \"IconFormat.hpp\"",
+        "",
+        "const uint8_t iconBlob[ICON_BLOB_SIZE] asm(\"_binary_generated_icons_bin_start\") = {",
+    ]
+    for i in range(0, len(blob), 16):
+        lines.append("   " + " ".join("0x%02x," % b for b in blob[i:i + 16]))
+    lines += ["};", ""]
+    return "\n".join(lines)
+
+
+def write_if_changed(file_name, data):
+    if os.path.exists(file_name):
+        with open(file_name, "rb") as f:
+            if f.read() == data:
+                return
+    with open(file_name, "wb") as f:
+        f.write(data)
+
+
+def main():
+    aliases = read_aliases()
+    used    = read_used_ids()
+    blob, entries = build_icons(used, aliases)
+    missing = set(aliases.values()) - set(icon_id(e[0]) for e in entries)
+    if missing:
+        raise ValueError("ICON_CODES uses icons without image: %s" % ", ".join(sorted(missing)))
+    os.makedirs(OUTPUT_DIR, exist_ok=True)
+    write_if_changed(BLOB_FILE, blob)
+    write_if_changed(INDEX_FILE, write_index(blob, entries, aliases).encode())
+    write_if_changed(ARRAY_FILE, write_array(blob).encode())
+
+    unique = len(set(v[3] for e in entries for v in e[1]))
+    masks  = len(set(v[4] for e in entries for v in e[1] if v[4] is not None))
+    print("Icons: %d images in %d sizes, %d aliases, %d unique bitmaps, %d masks, %d bytes"
+          % (len(entries), len(ICON_SIZES), len(aliases), unique, masks, len(blob)))
+
+
+main()